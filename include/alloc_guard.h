@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Counts heap allocations made by the calling task while an AllocGuard is in
+// scope and reports a violation when the section allocated. Guards on
+// different tasks (render and net) are counted separately; nested guards on
+// one task share its count. Only active when
+// ALLOC_GUARD is defined, which also requires malloc/calloc/realloc to be
+// wrapped at link time (see the debug environment in platformio.ini).
+// With ALLOC_GUARD_FATAL a violation aborts, so a debug run fails loudly.
+
+#ifndef ALLOC_GUARD_TASKS
+#define ALLOC_GUARD_TASKS 4 // tasks that can be inside a guard at the same time
+#endif
+
+#ifdef ALLOC_GUARD
+
+struct AllocGuardSlot;
+
+class AllocGuard
+{
+public:
+    explicit AllocGuard(const char *section);
+    ~AllocGuard();
+
+private:
+    const char *section;
+    AllocGuardSlot *slot; // nullptr when every slot was taken
+    uint32_t startCount;
+    bool outermost;
+};
+
+uint32_t allocGuardViolations();
+
+#else
+
+class AllocGuard
+{
+public:
+    explicit AllocGuard(const char *) {}
+};
+
+static inline uint32_t allocGuardViolations() { return 0; }
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Legibility backdrop behind the clock. Once per cover the decoded RGB888 art
+// under the clock text is box blurred (separable running sums, integers only)
+// and darkened by a scrim, both fading out over a feathered edge so no
+// rectangle shows. The result is baked into the cover, so frames pay nothing.
+
+#ifndef CLOCK_BACKDROP
+#define CLOCK_BACKDROP 1
+#endif
+#ifndef CLOCK_BACKDROP_BLUR_RADIUS
+#define CLOCK_BACKDROP_BLUR_RADIUS 2
+#endif
+#ifndef CLOCK_BACKDROP_PASSES
+#define CLOCK_BACKDROP_PASSES 2 // repeated box passes approach a Gaussian
+#endif
+#ifndef CLOCK_BACKDROP_DIM
+#define CLOCK_BACKDROP_DIM 160 // brightness kept under the text, out of 256
+#endif
+#ifndef CLOCK_BACKDROP_MARGIN
+#define CLOCK_BACKDROP_MARGIN 2 // pixels of full effect around the text
+#endif
+#ifndef CLOCK_BACKDROP_FEATHER
+#define CLOCK_BACKDROP_FEATHER 3 // pixels over which the effect fades out
+#endif
+
+struct BackdropRegion
+{
+    int16_t x, y, w, h;
+};
+
+// Allocates the work buffer for a width x height image
+bool backdropBegin(int width, int height);
+
+// Blurs and dims `region` (plus margin and feather) of a packed RGB888 image,
+// returns the time taken in microseconds
+uint32_t backdropApply(uint8_t *rgb, BackdropRegion region);
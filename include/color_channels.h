@@ -0,0 +1,9 @@
+#pragma once
+
+// RGB565 channel expansion and reduction, bit-exact with rounding
+// (v * 255 + 15) / 31 and its inverse, in forms that keep every
+// intermediate within 16 bits
+#define R5_TO_R8(v) ((uint8_t)(((v) * 527 + 23) >> 6))
+#define G6_TO_G8(v) ((uint8_t)(((v) * 259 + 33) >> 6))
+#define R8_TO_R5(v) ((uint16_t)(((v) * 249 + 1014) >> 11))
+#define G8_TO_G6(v) ((uint16_t)(((v) * 253 + 505) >> 10))
@@ -1,7 +1,11 @@
+#pragma once
+
 #include <Arduino.h>
 #include <map>
 #include <algorithm>
+#include <string.h>
 #include "config.h"
+#include "color_channels.h"
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 static inline uint16_t getClockDigitColor(int hour, int minute)
 {
@@ -81,7 +85,7 @@ static inline uint16_t getClockDigitColor(int hour, int minute)
 }
 
 // Function to calculate color similarity
-bool areColorsSimilar(uint16_t color1, uint16_t color2, uint16_t threshold)
+static inline bool areColorsSimilar(uint16_t color1, uint16_t color2, uint16_t threshold)
 {
   uint8_t r1 = (color1 >> 11) & 0x1F;
   uint8_t g1 = (color1 >> 5) & 0x3F;
@@ -117,7 +121,7 @@ static inline uint16_t rgb8ToRgb565(uint8_t r, uint8_t g, uint8_t b)
   return (r5 << 11) | (g6 << 5) | b5;
 }
 
-uint16_t invertColor(uint16_t color)
+static inline uint16_t invertColor(uint16_t color)
 {
   uint8_t r, g, b;
   rgb565ToRgb8(color, r, g, b);
@@ -130,7 +134,7 @@ uint16_t invertColor(uint16_t color)
 }
 
 // Function to calculate vibrancy (combination of saturation and brightness)
-float calculateVibrancy(uint16_t color)
+static inline float calculateVibrancy(uint16_t color)
 {
   uint8_t r, g, b;
   rgb565ToRgb8(color, r, g, b);
@@ -144,4 +148,164 @@ float calculateVibrancy(uint16_t color)
 
   // Combine saturation and brightness for vibrancy
   return saturation * brightness;
-}
\ No newline at end of file
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Batch kernels over whole RGB565 buffers.
+//
+// The conversions use multiply-shift forms that are bit-exact with
+// rgb565ToRgb8 / rgb8ToRgb565 above and keep every intermediate within 16 bits,
+// so the portable loops auto-vectorize with 16-bit lanes on the host and the
+// SWAR variants can pack two pixels into one 32-bit register on the ESP32-S3.
+// The dispatching functions (no suffix) pick the SWAR variant on the S3.
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && !defined(COLOR_TOOLS_PORTABLE_ONLY)
+#define COLOR_TOOLS_SWAR 1
+#endif
+
+// RGB565 -> packed RGB888 (3 bytes per pixel)
+static inline void rgb565ToRgb888BufferPortable(const uint16_t *__restrict src, uint8_t *__restrict dst, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    uint16_t c = src[i];
+    dst[i * 3 + 0] = R5_TO_R8(c >> 11);
+    dst[i * 3 + 1] = G6_TO_G8((c >> 5) & 0x3F);
+    dst[i * 3 + 2] = R5_TO_R8(c & 0x1F);
+  }
+}
+
+// Packed RGB888 -> RGB565
+static inline void rgb888ToRgb565BufferPortable(const uint8_t *__restrict src, uint16_t *__restrict dst, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    dst[i] = (R8_TO_R5(src[i * 3 + 0]) << 11) | (G8_TO_G6(src[i * 3 + 1]) << 5) | R8_TO_R5(src[i * 3 + 2]);
+  }
+}
+
+// Scales every channel by scale / 256 (256 = unchanged), truncating like the
+// brightness reductions in drawWeekDay / drawMonthDay
+static inline void scaleBrightnessBufferPortable(const uint16_t *src, uint16_t *dst, size_t count, uint16_t scale)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    uint16_t c = src[i];
+    uint16_t r = ((c >> 11) * scale) >> 8;
+    uint16_t g = (((c >> 5) & 0x3F) * scale) >> 8;
+    uint16_t b = ((c & 0x1F) * scale) >> 8;
+    dst[i] = (r << 11) | (g << 5) | b;
+  }
+}
+
+#if COLOR_TOOLS_SWAR
+// Two pixels per 32-bit word: each channel lives in a 16-bit lane
+static inline void rgb565ToRgb888BufferSwar(const uint16_t *src, uint8_t *dst, size_t count)
+{
+  size_t i = 0;
+  if (count && ((uintptr_t)src & 2))
+  {
+    rgb565ToRgb888BufferPortable(src, dst, 1);
+    i = 1;
+  }
+
+  for (; i + 2 <= count; i += 2)
+  {
+    uint32_t w;
+    memcpy(&w, src + i, sizeof(w));
+    uint32_t r = ((((w >> 11) & 0x001F001F) * 527 + 0x00170017) >> 6) & 0x00FF00FF;
+    uint32_t g = ((((w >> 5) & 0x003F003F) * 259 + 0x00210021) >> 6) & 0x00FF00FF;
+    uint32_t b = (((w & 0x001F001F) * 527 + 0x00170017) >> 6) & 0x00FF00FF;
+    uint8_t *d = dst + i * 3;
+    d[0] = r;
+    d[1] = g;
+    d[2] = b;
+    d[3] = r >> 16;
+    d[4] = g >> 16;
+    d[5] = b >> 16;
+  }
+
+  if (i < count)
+    rgb565ToRgb888BufferPortable(src + i, dst + i * 3, 1);
+}
+
+static inline void scaleBrightnessBufferSwar(const uint16_t *src, uint16_t *dst, size_t count, uint16_t scale)
+{
+  size_t i = 0;
+  if (((uintptr_t)src | (uintptr_t)dst) & 2)
+  {
+    scaleBrightnessBufferPortable(src, dst, count, scale);
+    return;
+  }
+
+  for (; i + 2 <= count; i += 2)
+  {
+    uint32_t w;
+    memcpy(&w, src + i, sizeof(w));
+    uint32_t r = ((((w >> 11) & 0x001F001F) * scale) >> 8) & 0x001F001F;
+    uint32_t g = ((((w >> 5) & 0x003F003F) * scale) >> 8) & 0x003F003F;
+    uint32_t b = (((w & 0x001F001F) * scale) >> 8) & 0x001F001F;
+    uint32_t out = (r << 11) | (g << 5) | b;
+    memcpy(dst + i, &out, sizeof(out));
+  }
+
+  if (i < count)
+    scaleBrightnessBufferPortable(src + i, dst + i, 1, scale);
+}
+#endif
+
+// Integer vibrancy (saturation * brightness) scaled to 0..65535, same ranking
+// as calculateVibrancy without float division per pixel
+static inline void vibrancyBuffer(const uint16_t *src, uint16_t *scores, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    uint16_t c = src[i];
+    uint32_t r = R5_TO_R8(c >> 11);
+    uint32_t g = G6_TO_G8((c >> 5) & 0x3F);
+    uint32_t b = R5_TO_R8(c & 0x1F);
+    uint32_t maxv = std::max({r, g, b});
+    uint32_t minv = std::min({r, g, b});
+    // (max - min) / max * (r + g + b) / 765 * 65535, and 65535 / 765 = 257 / 3
+    scores[i] = (maxv - minv) * (r + g + b) * 257 / (3 * std::max(maxv, 1u));
+  }
+}
+
+// Accumulates per-channel histograms in native RGB565 depth
+static inline void channelHistogram(const uint16_t *src, size_t count, uint32_t red[32], uint32_t green[64], uint32_t blue[32])
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    uint16_t c = src[i];
+    red[c >> 11]++;
+    green[(c >> 5) & 0x3F]++;
+    blue[c & 0x1F]++;
+  }
+}
+
+static inline void rgb565ToRgb888Buffer(const uint16_t *src, uint8_t *dst, size_t count)
+{
+#if COLOR_TOOLS_SWAR
+  rgb565ToRgb888BufferSwar(src, dst, count);
+#else
+  rgb565ToRgb888BufferPortable(src, dst, count);
+#endif
+}
+
+static inline void rgb888ToRgb565Buffer(const uint8_t *src, uint16_t *dst, size_t count)
+{
+  rgb888ToRgb565BufferPortable(src, dst, count);
+}
+
+static inline void scaleBrightnessBuffer(const uint16_t *src, uint16_t *dst, size_t count, uint16_t scale)
+{
+#if COLOR_TOOLS_SWAR
+  scaleBrightnessBufferSwar(src, dst, count, scale);
+#else
+  scaleBrightnessBufferPortable(src, dst, count, scale);
+#endif
+}
+
+#ifdef COLOR_TOOLS_SELFTEST
+// Checks the SWAR kernels against the portable ones and logs throughput
+bool colorToolsSelfTest();
+#endif
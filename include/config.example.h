@@ -36,6 +36,10 @@
 // Offsets in seconds for configTime(gmtOffset_sec, daylightOffset_sec,...)
 #define NTP_GMT_OFFSET_SECONDS (-10800)
 #define NTP_DAYLIGHT_OFFSET_SECONDS (0)
+// How often a synced time is saved to flash; after a power cycle it rejects older RTC or NTP times
+#define TIME_SAVE_INTERVAL_MS 3600000
+// A saved time that is ahead is replaced after this many SNTP replies agree on an earlier time
+#define TIME_FLOOR_OVERRIDE_SYNCS 3
 
 // RGB pins
 #define PIN_R1 42 
@@ -74,6 +78,20 @@
 #define DISPLAY_BRIGHTNESS 30   // 0-255 for display->setBrightness8
 #define NEOPIXEL_BRIGHTNESS 255 // 0-255 for NeoPixel
 #define COLOR_SIMILARITY_THRESHOLD 10
+#define PANEL_DOUBLE_BUFFER 1      // 0 = one DMA buffer (saves internal RAM), frames are staged in PSRAM
+#define PANEL_GAMMA 2.2f           // Panel response used to linearize sRGB colors
+#define PANEL_GAMMA_RED PANEL_GAMMA   // Per-channel gamma (1.0-3.5) if one channel looks off
+#define PANEL_GAMMA_GREEN PANEL_GAMMA
+#define PANEL_GAMMA_BLUE PANEL_GAMMA
+#define PANEL_WHITE_RED 256        // White balance gain per channel (1-256), e.g. lower green if skin looks green
+#define PANEL_WHITE_GREEN 256
+#define PANEL_WHITE_BLUE 256
+#define PANEL_COLOR_DEPTH_BITS 8   // Bits per channel the HUB75 driver shows (its PIXEL_COLOR_DEPTH_BITS)
+#define DITHER_TEMPORAL 0          // 1 = ordered dither that moves every frame, 0 = error diffusion once per cover
+#define SPOTIFY_POLL_INTERVAL_MS 1000 // Time between currently-playing requests
+#define SPOTIFY_STATS_REPORT_MS 60000 // Request count and track change latency summary interval
+// #define SPOTIFY_MOCK_HOST "192.168.1.20" // Poll tools/mock_spotify.py on this host instead of Spotify
+// #define SPOTIFY_MOCK_PORT 8080
 
 // ===== COLOR TEMPERATURE SETTINGS =====
 // Night time hour range (0-23 format)
@@ -87,3 +105,62 @@
 
 // Nighttime brightness dimming factor (0.0 to 1.0)
 #define NIGHT_DIM_FACTOR 0.3f
+
+// Night power profile (see include/power_profile.h)
+#define NIGHT_CPU_FREQ_MHZ 80                 // CPU clock at night (80 is the lowest WiFi supports)
+#define NIGHT_DISPLAY_BRIGHTNESS 30           // Panel brightness at night (0-255)
+#define NIGHT_SPOTIFY_POLL_INTERVAL_MS 15000  // Time between currently-playing requests at night
+
+// ===== NETWORK =====
+// Limits for blocking network calls (see include/net_guard.h)
+#define NET_CONNECT_TIMEOUT_MS 3000   // TCP/TLS connect timeout
+#define NET_READ_TIMEOUT_MS 3000      // Longest wait for the next bytes
+#define NET_BUDGET_MS 8000            // Deadline for one request, including the body
+#define NET_MAX_COVER_BYTES 65536     // Larger cover images are rejected
+#define COVER_MAX_DIMENSION 640       // Covers wider or taller than this are not decoded
+#define NET_STALL_RESTART_MS 60000    // Restart if one call is stuck this long (0 = never)
+#define NET_TASK_STACK_SIZE 12288     // Stack of the task that runs every network call
+#define NET_TASK_PRIORITY 1           // Same as the render loop, which runs on the other core
+
+// ===== FRAME STREAM =====
+// Live framebuffer mirror on http://PROJECTNAME.local/
+#define FRAME_STREAM_PORT 80
+#define FRAME_STREAM_MAX_FPS 10                 // Frames per second sent to viewers
+#define FRAME_STREAM_MAX_BYTES_PER_SEC 32768    // Bandwidth cap shared by all viewers
+#define FRAME_STREAM_KEYFRAME_INTERVAL_MS 10000 // Full frame resync interval
+#define FRAME_STREAM_TASK_PRIORITY 1            // Runs below the render loop
+
+// ===== FLEET MODE =====
+// Several clocks on one Spotify account: one polls, the others follow over UDP multicast
+#define FLEET_ENABLED 0                 // 1 = join the fleet
+#define FLEET_MULTICAST_GROUP 239, 255, 42, 99
+#define FLEET_PORT 4242
+#define FLEET_HEARTBEAT_MS 2000         // Leader repeats its state this often
+#define FLEET_LEADER_TIMEOUT_MS 7000    // Followers start polling after this much silence
+#define FLEET_QUIET_AFTER_FAILED_POLLS 3 // Leader stops sending after this many failed polls in a row
+#define FLEET_SHARE_COVER 1             // 1 = send decoded covers, 0 = followers download the image
+#define FLEET_FOLLOW_CHECK_MS 250       // How often a follower applies the leader's latest state
+#define FLEET_TASK_PRIORITY 1           // Task that sends heartbeats and cover chunks
+
+// ===== CLOCK BACKDROP =====
+// Blurred, dimmed patch of the cover behind the clock so the digits stay readable
+#define CLOCK_BACKDROP 1             // 0 = draw the clock straight over the art
+#define CLOCK_BACKDROP_BLUR_RADIUS 2 // Box blur radius in pixels
+#define CLOCK_BACKDROP_PASSES 2      // Blur passes (2-3 look close to a Gaussian)
+#define CLOCK_BACKDROP_DIM 160       // Brightness kept behind the digits (0-256)
+#define CLOCK_BACKDROP_MARGIN 2      // Full-strength pixels around the digits
+#define CLOCK_BACKDROP_FEATHER 3     // Pixels over which the effect fades out
+
+// ===== TRACK MARQUEE =====
+// Track and artist name scrolling under the clock while a song is playing
+#define MARQUEE_Y 52                // Top row of the text
+#define MARQUEE_FPS 30              // Frame rate while the text is scrolling
+#define MARQUEE_SPEED_PX_PER_SEC 20 // Scroll speed
+#define MARQUEE_GAP_PX 24           // Blank space before the text repeats
+#define MARQUEE_MAX_CHARS 128       // Longer titles are cut
+
+// ===== LOGGING =====
+// LOG_LEVEL_NONE, LOG_LEVEL_ERROR, LOG_LEVEL_WARN, LOG_LEVEL_INFO or LOG_LEVEL_DEBUG (see include/log.h)
+#define LOG_LEVEL LOG_LEVEL_INFO
+#define LOG_RING_SIZE 32 // Records buffered for the drain task (power of two)
+#define LOG_LINE_MAX 96  // Longer messages are cut
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Arduino.h>
+#include <JPEGDEC.h>
+#include "config.h"
+#include "net_guard.h"
+#include "jpeg_header.h"
+
+// Untrusted cover images go through here before they reach the decoder. The
+// JPEG markers are walked up to the frame header and the image is refused if
+// it is too large, too big in pixels, or of a kind JPEGDEC cannot decode. The
+// file is read into a buffer allocated once at boot and sized for the largest
+// download (NET_MAX_COVER_BYTES), so a bad file can cost neither heap nor
+// unbounded decode time. When a cover is refused the caller falls back to the
+// clock-only scene.
+
+bool coverIngestBegin();
+
+// Validates and decodes `filename` as RGB8888 at full size into `draw`
+CoverIngestResult coverIngestDecode(const char *filename, JPEG_DRAW_CALLBACK *draw);
+
+// Same for a buffer already in memory (used by the self test)
+CoverIngestResult coverIngestDecodeBuffer(uint8_t *data, size_t length, JPEG_DRAW_CALLBACK *draw);
+
+const char *coverIngestResultName(CoverIngestResult result);
+
+#ifdef COVER_INGEST_SELFTEST
+// Feeds truncated and mutated copies of `filename` through the header check
+// and decoder, then logs decode throughput. `reset` runs after every decode
+// to drop whatever state `draw` accumulates.
+void coverIngestSelfTest(const char *filename, JPEG_DRAW_CALLBACK *draw, void (*reset)());
+#endif
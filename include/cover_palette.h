@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+#include <map>
+#include <new>
+#include "config.h"
+
+// Clock colors from the decoded cover. The decoder hands over the image one
+// block at a time; coverPaletteStoreBlock() keeps the part that lands on the
+// cover buffer and counts its colors, and coverPaletteExtract() picks the
+// clock colors once the whole image went through. Nothing here touches the
+// decoder or the panel, so the host fuzz target can drive it with any block
+// layout a broken file could produce.
+
+// Custom allocator for PSRAM
+template <typename T>
+struct PSRAMAllocator
+{
+    typedef T value_type;
+
+    PSRAMAllocator() = default;
+    template <class U>
+    constexpr PSRAMAllocator(const PSRAMAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n)
+    {
+        if (n > std::size_t(-1) / sizeof(T))
+            throw std::bad_alloc();
+        if (auto p = static_cast<T *>(heap_caps_malloc(n * sizeof(T), MALLOC_CAP_SPIRAM)))
+            return p;
+        throw std::bad_alloc();
+    }
+
+    void deallocate(T *p, std::size_t) noexcept { heap_caps_free(p); }
+};
+
+template <class T, class U>
+bool operator==(const PSRAMAllocator<T> &, const PSRAMAllocator<U> &) { return true; }
+template <class T, class U>
+bool operator!=(const PSRAMAllocator<T> &, const PSRAMAllocator<U> &) { return false; }
+
+// RGB565 color -> pixels of that color
+typedef std::map<uint16_t, int, std::less<uint16_t>, PSRAMAllocator<std::pair<const uint16_t, int>>> ColorCounts;
+
+struct CoverPalette
+{
+    uint16_t mostCommon;
+    uint16_t leastCommon;
+    uint16_t primary;   // clock body, the most common color
+    uint16_t secondary; // clock outline, contrasting with primary
+};
+
+// Stores the part of a decoded block of RGB8888 pixels (R, G, B, A bytes) at
+// (x, y) that lands on the width x height packed RGB888 `rgb`, wherever the
+// decoder places it, and counts its colors
+void coverPaletteStoreBlock(uint8_t *rgb, int width, int height, const uint32_t *pixels, int x, int y,
+                            int blockWidth, int blockHeight, ColorCounts &counts);
+
+// Most vibrant of the counted colors, 0 if there are none
+uint16_t extractMostVibrantColor(const ColorCounts &counts);
+
+// Picks the clock colors; false when nothing was counted
+bool coverPaletteExtract(const ColorCounts &counts, CoverPalette &palette);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "marquee.h"
+#include "fleet_election.h"
+
+// Fleet mode: several clocks on one Spotify account share a single poller.
+//
+// Every clock advertises _spotclock._udp over mDNS and sends a heartbeat to a
+// UDP multicast group. The live clock with the lowest id (from the MAC) is the
+// leader: it polls Spotify and multicasts the now-playing state with every
+// heartbeat, and with FLEET_SHARE_COVER also the decoded cover in chunks.
+// The others follow those packets and stop polling. When no lower id has been
+// heard for FLEET_LEADER_TIMEOUT_MS a follower takes over by itself (the rules
+// are in fleet_election.h). All sending happens on a small task of its own, so
+// a publish or heartbeat never waits for the socket in the caller.
+
+#ifndef FLEET_ENABLED
+#define FLEET_ENABLED 0
+#endif
+#ifndef FLEET_MULTICAST_GROUP
+#define FLEET_MULTICAST_GROUP 239, 255, 42, 99
+#endif
+#ifndef FLEET_PORT
+#define FLEET_PORT 4242
+#endif
+#ifndef FLEET_SHARE_COVER
+#define FLEET_SHARE_COVER 1
+#endif
+#ifndef FLEET_COVER_RESEND_MS
+#define FLEET_COVER_RESEND_MS 10000
+#endif
+#ifndef FLEET_FOLLOW_CHECK_MS
+#define FLEET_FOLLOW_CHECK_MS 250 // how often a follower looks at received packets
+#endif
+#ifndef FLEET_TASK_PRIORITY
+#define FLEET_TASK_PRIORITY 1
+#endif
+
+#define FLEET_MAX_PEERS 8
+#define FLEET_URL_MAX 192
+#define FLEET_COVER_CHUNK_BYTES 1024
+
+struct FleetNowPlaying
+{
+    uint32_t sequence; // bumped by the leader on every change
+    bool playing;
+    uint32_t trackHash;
+    uint32_t coverHash;
+    uint16_t primaryColor;
+    uint16_t secondaryColor;
+    char coverUrl[FLEET_URL_MAX];
+    char text[MARQUEE_MAX_BYTES];
+};
+
+bool fleetBegin(size_t coverBytes);
+
+// True while another clock is leading; the caller should not poll Spotify
+bool fleetIsFollower();
+uint32_t fleetNodeId();
+
+// Leader side: publish the state after each successful poll (only changes
+// are counted as a new sequence), report each failed one, and publish the
+// decoded cover after each decode
+void fleetPublish(const FleetNowPlaying &state);
+void fleetPollFailed();
+void fleetPublishCover(uint32_t coverHash, const uint8_t *pixels);
+
+// Follower side: latest state from the leader, false if none yet
+bool fleetLatest(FleetNowPlaying &state);
+
+// Copies a complete shared cover with the given hash, false while incomplete
+bool fleetTakeCover(uint32_t coverHash, uint8_t *pixels);
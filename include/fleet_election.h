@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+
+// Leader election of fleet mode, without any networking so the host tests can
+// run several clocks against one virtual network.
+//
+// A clock that is not following sends its state each FLEET_HEARTBEAT_MS, as
+// long as its own Spotify polls succeed: after FLEET_QUIET_AFTER_FAILED_POLLS
+// failures in a row, or no successful poll for a poll interval plus
+// FLEET_LEADER_TIMEOUT_MS, it goes quiet so a clock that can still reach
+// Spotify takes over. A receiver follows the lowest sender it hears; a higher
+// id only replaces the current leader once that one has been silent for
+// FLEET_LEADER_TIMEOUT_MS. A clock follows while its leader is alive and has
+// a lower id than its own.
+
+#ifndef FLEET_HEARTBEAT_MS
+#define FLEET_HEARTBEAT_MS 2000
+#endif
+#ifndef FLEET_LEADER_TIMEOUT_MS
+#define FLEET_LEADER_TIMEOUT_MS 7000
+#endif
+#ifndef FLEET_QUIET_AFTER_FAILED_POLLS
+#define FLEET_QUIET_AFTER_FAILED_POLLS 3
+#endif
+
+struct FleetElection
+{
+    uint32_t nodeId;
+    uint32_t leaderId;
+    uint32_t lastLeaderMs;
+    bool heard; // a leader has been accepted at least once
+
+    // Own polls
+    uint32_t lastPollOkMs;
+    uint8_t failedPolls; // in a row
+    bool polledOk;       // at least one poll succeeded
+};
+
+static inline void fleetElectionBegin(FleetElection &election, uint32_t nodeId)
+{
+    election = {nodeId, 0, 0, false, 0, 0, false};
+}
+
+static inline bool fleetElectionLeaderAlive(const FleetElection &election, uint32_t nowMs)
+{
+    return election.heard && nowMs - election.lastLeaderMs < FLEET_LEADER_TIMEOUT_MS;
+}
+
+// Called for every state packet from another clock. Returns true when the
+// packet comes from the (possibly new) leader and its state should be taken.
+static inline bool fleetElectionHeard(FleetElection &election, uint32_t sender, uint32_t nowMs)
+{
+    if (sender == election.nodeId)
+        return false;
+    if (fleetElectionLeaderAlive(election, nowMs) && sender > election.leaderId)
+        return false;
+
+    election.leaderId = sender;
+    election.lastLeaderMs = nowMs;
+    election.heard = true;
+    return true;
+}
+
+static inline bool fleetElectionIsFollower(const FleetElection &election, uint32_t nowMs)
+{
+    return fleetElectionLeaderAlive(election, nowMs) && election.leaderId < election.nodeId;
+}
+
+// Called after every Spotify poll this clock makes
+static inline void fleetElectionPolled(FleetElection &election, bool ok, uint32_t nowMs)
+{
+    if (ok)
+    {
+        election.lastPollOkMs = nowMs;
+        election.failedPolls = 0;
+        election.polledOk = true;
+    }
+    else if (election.failedPolls < UINT8_MAX)
+    {
+        election.failedPolls++;
+    }
+}
+
+// True when this clock should send a heartbeat: it leads and still reaches Spotify
+static inline bool fleetElectionShouldSend(const FleetElection &election, uint32_t nowMs, uint32_t pollIntervalMs)
+{
+    return !fleetElectionIsFollower(election, nowMs) && election.polledOk &&
+           election.failedPolls < FLEET_QUIET_AFTER_FAILED_POLLS &&
+           nowMs - election.lastPollOkMs <= pollIntervalMs + FLEET_LEADER_TIMEOUT_MS;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Wire format of the framebuffer mirror (little endian):
+//
+//   header  : type ('K' keyframe / 'D' delta), width, height, 0, uint32 sequence
+//   payload : uint16 tokens over the frame XOR its reference, row-major.
+//             Bit 15 clear -> run of N unchanged (zero) pixels.
+//             Bit 15 set   -> N literal words follow.
+//
+// A keyframe uses an all-black reference, so its literals are the raw pixels.
+// A delta uses the previously sent frame, so the client XORs literals into the
+// frame it already holds.
+
+#define FRAME_CODEC_HEADER_BYTES 8
+#define FRAME_CODEC_MAX_RUN 0x7FFF
+
+// Worst case is one token per literal run of a single pixel
+static inline size_t frameCodecMaxBytes(size_t pixels)
+{
+    return FRAME_CODEC_HEADER_BYTES + pixels * 4;
+}
+
+static inline void frameCodecPut16(uint8_t *&out, uint16_t v)
+{
+    *out++ = v & 0xFF;
+    *out++ = v >> 8;
+}
+
+// Encodes `frame` against `reference` (nullptr for a keyframe). Returns the
+// message size, or 0 if `capacity` is too small.
+static inline size_t encodeFrame(const uint16_t *frame, const uint16_t *reference,
+                                 uint8_t width, uint8_t height, uint32_t sequence,
+                                 uint8_t *out, size_t capacity)
+{
+    const size_t pixels = (size_t)width * height;
+    if (capacity < frameCodecMaxBytes(pixels))
+        return 0;
+
+    uint8_t *p = out;
+    *p++ = reference ? 'D' : 'K';
+    *p++ = width;
+    *p++ = height;
+    *p++ = 0;
+    frameCodecPut16(p, sequence & 0xFFFF);
+    frameCodecPut16(p, sequence >> 16);
+
+    size_t i = 0;
+    while (i < pixels)
+    {
+        // Run of unchanged pixels
+        size_t run = 0;
+        while (i + run < pixels && run < FRAME_CODEC_MAX_RUN &&
+               (frame[i + run] ^ (reference ? reference[i + run] : 0)) == 0)
+            run++;
+
+        // A lone unchanged pixel is cheaper inside a literal run
+        if (run >= 2 || i + run == pixels)
+        {
+            if (run)
+                frameCodecPut16(p, run);
+            i += run;
+            continue;
+        }
+
+        // Literal run: stop at the next pair of unchanged pixels
+        uint8_t *token = p;
+        p += 2;
+        size_t count = 0;
+        while (i < pixels && count < FRAME_CODEC_MAX_RUN)
+        {
+            uint16_t x0 = frame[i] ^ (reference ? reference[i] : 0);
+            if (x0 == 0 && i + 1 < pixels &&
+                (frame[i + 1] ^ (reference ? reference[i + 1] : 0)) == 0)
+                break;
+            frameCodecPut16(p, x0);
+            i++;
+            count++;
+        }
+        frameCodecPut16(token, 0x8000 | count);
+    }
+
+    return p - out;
+}
+
+static inline uint16_t frameCodecGet16(const uint8_t *in)
+{
+    return in[0] | (in[1] << 8);
+}
+
+// Client side, the same steps as the viewer page: applies one message to the
+// `frame` the client holds. Returns false if the message is malformed or does
+// not match the frame size; `frame` may then be partly updated.
+static inline bool decodeFrame(const uint8_t *in, size_t length, uint16_t *frame,
+                               uint8_t width, uint8_t height, uint32_t *sequence)
+{
+    if (length < FRAME_CODEC_HEADER_BYTES || (in[0] != 'K' && in[0] != 'D') ||
+        in[1] != width || in[2] != height)
+        return false;
+
+    const size_t pixels = (size_t)width * height;
+    if (in[0] == 'K')
+    {
+        for (size_t i = 0; i < pixels; i++)
+            frame[i] = 0;
+    }
+    if (sequence)
+        *sequence = frameCodecGet16(in + 4) | ((uint32_t)frameCodecGet16(in + 6) << 16);
+
+    size_t i = 0;
+    size_t p = FRAME_CODEC_HEADER_BYTES;
+    while (p + 2 <= length)
+    {
+        uint16_t token = frameCodecGet16(in + p);
+        p += 2;
+        size_t count = token & FRAME_CODEC_MAX_RUN;
+        if (count > pixels - i)
+            return false;
+
+        if (token & 0x8000)
+        {
+            if (count * 2 > length - p)
+                return false;
+            for (; count > 0; count--, p += 2)
+                frame[i++] ^= frameCodecGet16(in + p);
+        }
+        else
+        {
+            i += count;
+        }
+    }
+
+    return p == length && i == pixels;
+}
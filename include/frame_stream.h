@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "shadow_panel.h"
+
+// Framebuffer mirror: serves a viewer page on http://PROJECTNAME.local/ and
+// streams the panel contents over a WebSocket at /ws (see frame_codec.h).
+
+#ifndef FRAME_STREAM_PORT
+#define FRAME_STREAM_PORT 80
+#endif
+#ifndef FRAME_STREAM_MAX_FPS
+#define FRAME_STREAM_MAX_FPS 10
+#endif
+#ifndef FRAME_STREAM_MAX_BYTES_PER_SEC
+#define FRAME_STREAM_MAX_BYTES_PER_SEC 32768
+#endif
+#ifndef FRAME_STREAM_KEYFRAME_INTERVAL_MS
+#define FRAME_STREAM_KEYFRAME_INTERVAL_MS 10000
+#endif
+#ifndef FRAME_STREAM_TASK_PRIORITY
+#define FRAME_STREAM_TASK_PRIORITY 1
+#endif
+
+struct FrameStreamStats
+{
+    uint32_t framesSent;
+    uint32_t keyframesSent;
+    uint32_t framesSkipped; // throttled by the bandwidth cap or a full client queue
+    uint32_t bytesSent;
+    uint32_t lastEncodeMicros;
+};
+
+bool frameStreamBegin(ShadowPanel *panel);
+FrameStreamStats frameStreamStats();
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+// JPEG marker walk used by cover_ingest.h to vet a cover before decoding.
+// It has no Arduino dependencies, so test/fuzz_cover_ingest.cpp can build it
+// on the host and feed it arbitrary bytes.
+
+#ifndef COVER_MAX_DIMENSION
+#define COVER_MAX_DIMENSION 640 // wider or taller images are refused
+#endif
+
+enum CoverIngestResult : uint8_t
+{
+    COVER_OK,
+    COVER_NO_FILE,
+    COVER_TOO_LARGE,      // more than NET_MAX_COVER_BYTES
+    COVER_MALFORMED,      // broken marker structure or no frame header
+    COVER_UNSUPPORTED,    // not baseline/progressive 8-bit Huffman, odd sampling
+    COVER_TOO_MANY_PIXELS, // beyond COVER_MAX_DIMENSION
+    COVER_DECODE_FAILED,
+    COVER_RESULT_COUNT
+};
+
+struct JpegFrameInfo
+{
+    uint16_t width;
+    uint16_t height;
+    uint8_t components;
+    bool progressive;
+};
+
+// Walks the markers of `data` up to the first start-of-frame; never reads
+// past `length`
+CoverIngestResult jpegReadFrameInfo(const uint8_t *data, size_t length, JpegFrameInfo &info);
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <Arduino.h>
+#include <inttypes.h>
+#include <type_traits>
+#include "config.h"
+
+// Asynchronous logger. Records go into a fixed lock-free ring and a low
+// priority task writes them to Serial, so logging never waits on USB-CDC.
+//
+//   LOG_E/W/I/D(fmt, ...)        formats into the ring slot on the caller
+//   LOG_E/W/I/D_DEFER(fmt, ...)  stores fmt + up to LOG_MAX_ARGS integer
+//                                arguments, formatted later by the drain task.
+//                                fmt must be a string literal.
+//   LOG_EVERY_MS(ms, LOG_X(...)) emits at most once per `ms` per call site
+//
+// Levels above LOG_LEVEL compile to nothing. A full ring drops the record and
+// counts it; the drain task reports the count.
+//
+// uint32_t / int32_t arguments take PRIu32 / PRId32 rather than %lu / %ld;
+// the two differ between toolchains and LOG_* formats are checked.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 32 // must be a power of two
+#endif
+#ifndef LOG_LINE_MAX
+#define LOG_LINE_MAX 96
+#endif
+#ifndef LOG_TASK_PRIORITY
+#define LOG_TASK_PRIORITY 1
+#endif
+
+#define LOG_MAX_ARGS 6
+
+void logBegin();
+void logWrite(uint8_t level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void logEnqueueDeferred(uint8_t level, const char *fmt, const uint32_t *args, uint8_t count);
+uint32_t logDroppedCount();
+
+template <typename... T>
+struct LogArgsAreIntegers
+{
+    static const bool value = true;
+};
+
+template <typename H, typename... T>
+struct LogArgsAreIntegers<H, T...>
+{
+    static const bool value = (std::is_integral<H>::value || std::is_enum<H>::value) && LogArgsAreIntegers<T...>::value;
+};
+
+template <typename... T>
+inline void logDeferred(uint8_t level, const char *fmt, T... args)
+{
+    static_assert(sizeof...(T) <= LOG_MAX_ARGS, "too many deferred log arguments");
+    static_assert(LogArgsAreIntegers<T...>::value, "deferred log arguments must be integers");
+    const uint32_t packed[LOG_MAX_ARGS] = {static_cast<uint32_t>(args)...};
+    logEnqueueDeferred(level, fmt, packed, sizeof...(T));
+}
+
+// Per call site state for LOG_EVERY_MS
+struct LogRateLimit
+{
+    uint32_t lastMs = 0;
+    uint32_t suppressed = 0;
+    bool started = false;
+
+    bool allow(uint32_t intervalMs)
+    {
+        uint32_t now = millis();
+        if (started && now - lastMs < intervalMs)
+        {
+            suppressed++;
+            return false;
+        }
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+        if (suppressed)
+            logDeferred(LOG_LEVEL_INFO, "(%u repeats suppressed)", suppressed);
+#endif
+        started = true;
+        lastMs = now;
+        suppressed = 0;
+        return true;
+    }
+};
+
+#define LOG_EVERY_MS(ms, statement)             \
+    do                                          \
+    {                                           \
+        static LogRateLimit _logRateLimit;      \
+        if (_logRateLimit.allow(ms))            \
+        {                                       \
+            statement;                          \
+        }                                       \
+    } while (0)
+
+#define LOG_NOTHING(...) \
+    do                   \
+    {                    \
+    } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(fmt, ...) logWrite(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define LOG_E_DEFER(fmt, ...) logDeferred(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_E LOG_NOTHING
+#define LOG_E_DEFER LOG_NOTHING
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(fmt, ...) logWrite(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_W_DEFER(fmt, ...) logDeferred(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_W LOG_NOTHING
+#define LOG_W_DEFER LOG_NOTHING
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(fmt, ...) logWrite(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOG_I_DEFER(fmt, ...) logDeferred(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_I LOG_NOTHING
+#define LOG_I_DEFER LOG_NOTHING
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(fmt, ...) logWrite(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define LOG_D_DEFER(fmt, ...) logDeferred(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_D LOG_NOTHING
+#define LOG_D_DEFER LOG_NOTHING
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include "config.h"
+
+#ifndef MARQUEE_Y
+#define MARQUEE_Y 52
+#endif
+#ifndef MARQUEE_FPS
+#define MARQUEE_FPS 30
+#endif
+#ifndef MARQUEE_SPEED_PX_PER_SEC
+#define MARQUEE_SPEED_PX_PER_SEC 20
+#endif
+#ifndef MARQUEE_GAP_PX
+#define MARQUEE_GAP_PX 24
+#endif
+#ifndef MARQUEE_MAX_CHARS
+#define MARQUEE_MAX_CHARS 128
+#endif
+
+#define MARQUEE_GLYPH_WIDTH 6 // 5 columns + 1 spacing in the classic GFX font
+#define MARQUEE_GLYPH_HEIGHT 8
+#define MARQUEE_MAX_BYTES (MARQUEE_MAX_CHARS * 4 + 1)
+
+// Scrolling single-line text. The string is rasterized once with the classic
+// GFX font into a PSRAM strip of one 16-bit word per column (bit n = row n)
+// plus a precomputed outline mask, so each frame only copies a 64 column window.
+class Marquee
+{
+public:
+    bool begin();
+
+    // Re-rasterizes only when the text differs from the current one
+    void setText(const char *utf8);
+    void clear();
+
+    bool isEmpty() const { return stripWidth == 0; }
+    bool isScrolling() const { return stripWidth > displayWidth; }
+
+    void draw(Adafruit_GFX *gfx, int16_t y, uint16_t color, uint16_t outlineColor, uint32_t nowMs);
+
+    uint32_t lastRenderMicros() const { return renderMicros; }
+    uint32_t lastDrawMicros() const { return drawMicros; }
+
+private:
+    char text[MARQUEE_MAX_BYTES] = "";
+    uint16_t *glyphs = nullptr;
+    uint16_t *outline = nullptr;
+    int16_t stripWidth = 0;
+    int16_t displayWidth = 64;
+    uint32_t startMs = 0;
+    uint32_t renderMicros = 0;
+    uint32_t drawMicros = 0;
+};
+
+// Maps a Unicode code point to a character of the GFX classic font (CP437),
+// falling back to the closest ASCII letter or '?'
+uint8_t marqueeGlyphFor(uint32_t codepoint);
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Boot-time memory budget. Call memoryReportBegin() first, then
+// memoryReportMark("name") after each subsystem has started; the difference in
+// free internal RAM and PSRAM since the previous mark is charged to it.
+// memoryReportLog() prints the table with what is left for TLS and WiFi.
+
+#define MEMORY_REPORT_MAX_ENTRIES 16
+
+void memoryReportBegin();
+void memoryReportMark(const char *subsystem);
+void memoryReportLog();
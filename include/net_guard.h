@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Time budgets for blocking network calls. All of them run on the net task
+// (NET_TASK_*), which hands its results to the render loop as a snapshot, so
+// a slow socket delays the next update but never a frame.
+//
+// Each call runs inside a NetOperation that names its current stage and
+// carries a deadline. Code that owns its read loop (the cover download) polls
+// expired() and gives up; calls inside libraries are bounded by their own
+// timeouts. A monitor timer logs any operation that outlives its budget,
+// keeps the stage in RTC memory and restarts the device after
+// NET_STALL_RESTART_MS, or once an operation made no progress for
+// NET_WATCHDOG_S, so a wedged socket cannot freeze the clock. The timer only
+// signals a small task to do the restart, after the log had time to drain.
+//
+// The calling task is also subscribed to the task watchdog for the duration
+// of the operation, which prints its backtrace when it hangs. The watchdog's
+// panic setting applies to every subscribed task (the idle tasks too), so
+// netGuardBegin() only raises the timeout to NET_WATCHDOG_S and leaves panic
+// off, as the core configures it; the restart is the monitor's. NET_WATCHDOG_S
+// outlasts a full budget plus one read timeout, since library calls only
+// report progress when they return. The stage that was running before a
+// stall restart is logged on the next boot.
+
+#ifndef NET_CONNECT_TIMEOUT_MS
+#define NET_CONNECT_TIMEOUT_MS 3000
+#endif
+#ifndef NET_READ_TIMEOUT_MS
+#define NET_READ_TIMEOUT_MS 3000
+#endif
+#ifndef NET_BUDGET_MS
+#define NET_BUDGET_MS 8000
+#endif
+#ifndef NET_MAX_COVER_BYTES
+#define NET_MAX_COVER_BYTES (64 * 1024)
+#endif
+#ifndef NET_STALL_RESTART_MS
+#define NET_STALL_RESTART_MS 60000 // 0 = never restart
+#endif
+#ifndef NET_TASK_STACK_SIZE
+#define NET_TASK_STACK_SIZE 12288 // TLS handshakes take most of it
+#endif
+#ifndef NET_TASK_PRIORITY
+#define NET_TASK_PRIORITY 1
+#endif
+
+#define NET_WATCHDOG_S ((NET_BUDGET_MS + NET_READ_TIMEOUT_MS + 999) / 1000)
+
+enum NetStage : uint8_t
+{
+    NET_STAGE_IDLE,
+    NET_STAGE_CONNECTIVITY,
+    NET_STAGE_SPOTIFY_POLL,
+    NET_STAGE_TOKEN_REFRESH,
+    NET_STAGE_COVER_REQUEST,
+    NET_STAGE_COVER_BODY,
+    NET_STAGE_COUNT
+};
+
+class NetOperation
+{
+public:
+    explicit NetOperation(NetStage stage, uint32_t budgetMs = NET_BUDGET_MS);
+    ~NetOperation();
+
+    void stage(NetStage next);
+
+    // Feeds the task watchdog; call whenever data moved
+    void progress();
+
+    // Deadline passed or netCancel() was called
+    bool expired() const;
+    uint32_t elapsedMs() const;
+    uint32_t remainingMs() const;
+
+private:
+    uint32_t startMs;
+    uint32_t budgetMs;
+    bool watchdogAdded;
+};
+
+void netGuardBegin();
+
+// Asks the running operation to stop at its next expired() check
+void netCancel();
+
+const char *netStageName(NetStage stage);
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Output stage between 8-bit sRGB colors and the HUB75 driver. The driver's own
+// CIE1931 table is disabled (NO_CIE1931), so every color goes through a gamma
+// LUT into 16-bit linear light here and is quantized to the panel's real
+// bit-plane depth. Album art is dithered on the way down; flat UI colors are
+// rounded through small per-channel tables.
+//
+// The LUTs also carry the panel calibration: a gamma and a white balance gain
+// per channel, from the constants below or from the "panel" NVS namespace
+// (floats gamma_r/g/b, ushorts white_r/g/b) when present. Everything is built
+// once in panelColorBegin(), so calibration costs nothing per frame. Building
+// the tables needs no hardware; the host tests check them for every
+// calibration in range.
+
+#ifndef PANEL_GAMMA
+#define PANEL_GAMMA 2.2f
+#endif
+#ifndef PANEL_GAMMA_RED
+#define PANEL_GAMMA_RED PANEL_GAMMA
+#endif
+#ifndef PANEL_GAMMA_GREEN
+#define PANEL_GAMMA_GREEN PANEL_GAMMA
+#endif
+#ifndef PANEL_GAMMA_BLUE
+#define PANEL_GAMMA_BLUE PANEL_GAMMA
+#endif
+
+// White balance: linear gain per channel out of 256, applied after gamma
+#ifndef PANEL_WHITE_RED
+#define PANEL_WHITE_RED 256
+#endif
+#ifndef PANEL_WHITE_GREEN
+#define PANEL_WHITE_GREEN 256
+#endif
+#ifndef PANEL_WHITE_BLUE
+#define PANEL_WHITE_BLUE 256
+#endif
+
+#define PANEL_GAMMA_MIN 1.0f
+#define PANEL_GAMMA_MAX 3.5f
+
+// Bits per channel actually shown by the driver (its PIXEL_COLOR_DEPTH_BITS)
+#ifndef PANEL_COLOR_DEPTH_BITS
+#ifdef PIXEL_COLOR_DEPTH_BITS
+#define PANEL_COLOR_DEPTH_BITS PIXEL_COLOR_DEPTH_BITS
+#else
+#define PANEL_COLOR_DEPTH_BITS 8
+#endif
+#endif
+
+// 0 = Floyd-Steinberg once per cover, 1 = ordered dither re-seeded every frame
+#ifndef DITHER_TEMPORAL
+#define DITHER_TEMPORAL 0
+#endif
+
+// Widest image ditherErrorDiffusion() takes; its error rows are static
+#ifndef DITHER_MAX_WIDTH
+#define DITHER_MAX_WIDTH 64
+#endif
+
+static_assert(PANEL_COLOR_DEPTH_BITS >= 1 && PANEL_COLOR_DEPTH_BITS <= 8, "PANEL_COLOR_DEPTH_BITS must be 1..8");
+static_assert(PANEL_GAMMA_RED >= PANEL_GAMMA_MIN && PANEL_GAMMA_RED <= PANEL_GAMMA_MAX &&
+                  PANEL_GAMMA_GREEN >= PANEL_GAMMA_MIN && PANEL_GAMMA_GREEN <= PANEL_GAMMA_MAX &&
+                  PANEL_GAMMA_BLUE >= PANEL_GAMMA_MIN && PANEL_GAMMA_BLUE <= PANEL_GAMMA_MAX,
+              "PANEL_GAMMA_* must be 1.0..3.5");
+static_assert(PANEL_WHITE_RED >= 1 && PANEL_WHITE_RED <= 256 && PANEL_WHITE_GREEN >= 1 && PANEL_WHITE_GREEN <= 256 &&
+                  PANEL_WHITE_BLUE >= 1 && PANEL_WHITE_BLUE <= 256,
+              "PANEL_WHITE_* must be 1..256");
+
+#define PANEL_LEVELS ((1 << PANEL_COLOR_DEPTH_BITS) - 1)
+
+extern uint16_t panelGammaLut[3][256];   // sRGB 8-bit -> linear 0..65535, per channel
+extern uint16_t panelLevelLinear[256];   // quantized level -> linear 0..65535
+extern uint8_t panelRed5[32];            // RGB565 channel -> driver byte, rounded
+extern uint8_t panelGreen6[64];
+extern uint8_t panelBlue5[32];
+
+struct PanelCalibration
+{
+    float gamma[3];     // R, G, B
+    uint16_t white[3];  // gain out of 256
+};
+
+#define PANEL_CALIBRATION_DEFAULT                               \
+    {                                                           \
+        {PANEL_GAMMA_RED, PANEL_GAMMA_GREEN, PANEL_GAMMA_BLUE}, \
+        {PANEL_WHITE_RED, PANEL_WHITE_GREEN, PANEL_WHITE_BLUE}  \
+    }
+
+// The constants above, overridden by a calibration saved in NVS. Values out
+// of range are ignored so a bad entry cannot invert or blank a channel.
+PanelCalibration panelCalibrationLoad();
+
+// Builds every table from `cal`
+void panelColorBegin(const PanelCalibration &cal);
+
+// Calibration the tables were built from
+PanelCalibration panelCalibration();
+
+// Nearest panel level for a linear value
+static inline uint8_t panelQuantize(uint32_t linear)
+{
+    return (linear * PANEL_LEVELS + 32767) / 65535;
+}
+
+// The driver shows the top PANEL_COLOR_DEPTH_BITS of each byte
+static inline uint8_t panelLevelToByte(uint8_t level)
+{
+    return level << (8 - PANEL_COLOR_DEPTH_BITS);
+}
+
+static inline void panelColor565(uint16_t color, uint8_t &r, uint8_t &g, uint8_t &b)
+{
+    r = panelRed5[color >> 11];
+    g = panelGreen6[(color >> 5) & 0x3F];
+    b = panelBlue5[color & 0x1F];
+}
+
+// Packed RGB888 (sRGB) -> packed driver bytes, error diffused. Integer only.
+// Returns false and leaves `dst` alone when width is not 1..DITHER_MAX_WIDTH.
+bool ditherErrorDiffusion(const uint8_t *src, uint8_t *dst, int width, int height);
+
+// Packed RGB888 (sRGB) -> packed driver bytes with a 4x4 Bayer threshold whose
+// phase moves with `frame`, so the pattern averages out over time
+void ditherOrdered(const uint8_t *src, uint8_t *dst, int width, int height, uint32_t frame);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESP32-HUB75-MatrixPanel-I2S-DMA.h>
+#include "config.h"
+
+// Day / night power profiles. Between NIGHT_START_HOUR and NIGHT_END_HOUR the
+// CPU is clocked down, WiFi uses maximum modem sleep, the panel brightness can
+// be lowered and Spotify is polled less often. Profiles are switched right
+// after a flip, so the change lands between two frames.
+
+#ifndef SPOTIFY_POLL_INTERVAL_MS
+#define SPOTIFY_POLL_INTERVAL_MS 1000
+#endif
+#ifndef NIGHT_CPU_FREQ_MHZ
+#define NIGHT_CPU_FREQ_MHZ 80 // lowest clock WiFi still runs at
+#endif
+#ifndef NIGHT_DISPLAY_BRIGHTNESS
+#define NIGHT_DISPLAY_BRIGHTNESS DISPLAY_BRIGHTNESS
+#endif
+#ifndef NIGHT_SPOTIFY_POLL_INTERVAL_MS
+#define NIGHT_SPOTIFY_POLL_INTERVAL_MS 15000
+#endif
+
+enum PowerProfile : uint8_t
+{
+    POWER_PROFILE_DAY,
+    POWER_PROFILE_NIGHT,
+};
+
+static inline bool isNightHour(int hour)
+{
+    return hour < NIGHT_END_HOUR || hour >= NIGHT_START_HOUR;
+}
+
+// Applies the profile for the current local time; stays on day until the
+// clock has been set. Does nothing when the profile is unchanged.
+void powerProfileUpdate(MatrixPanel_I2S_DMA *display);
+
+PowerProfile powerProfileCurrent();
+uint32_t powerProfilePollIntervalMs();
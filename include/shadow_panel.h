@@ -0,0 +1,269 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <ESP32-HUB75-MatrixPanel-I2S-DMA.h>
+#include "panel_color.h"
+
+#define PANEL_WIDTH 64
+#define PANEL_HEIGHT 64
+#define PANEL_PIXELS (PANEL_WIDTH * PANEL_HEIGHT)
+
+#ifndef PANEL_DOUBLE_BUFFER
+#define PANEL_DOUBLE_BUFFER 1
+#endif
+
+// The HUB75 driver stores pixels as bit-planes inside its DMA descriptors, which
+// cannot be read back. ShadowPanel mirrors every draw into an RGB565 shadow
+// buffer in PSRAM and publishes it as a snapshot on flipDMABuffer(), so other
+// tasks can see what is on the panel without touching the DMA buffers.
+// Colors are mirrored as drawn and sent to the driver through panel_color.h.
+//
+// With a single DMA buffer (cfg.double_buff = false) drawing straight into it
+// would show every clear and redraw. In that mode draws only land in a PSRAM
+// staging frame of driver bytes, and flipDMABuffer() writes the pixels that
+// differ from the last committed frame, so the live buffer changes in one
+// short burst per frame.
+class ShadowPanel : public MatrixPanel_I2S_DMA
+{
+public:
+    explicit ShadowPanel(const HUB75_I2S_CFG &cfg) : MatrixPanel_I2S_DMA(cfg), staged(!cfg.double_buff) {}
+
+    bool begin()
+    {
+        if (!back)
+        {
+            back = static_cast<uint16_t *>(heap_caps_calloc(PANEL_PIXELS, sizeof(uint16_t), MALLOC_CAP_SPIRAM));
+            front = static_cast<uint16_t *>(heap_caps_calloc(PANEL_PIXELS, sizeof(uint16_t), MALLOC_CAP_SPIRAM));
+        }
+        if (staged && !stage)
+        {
+            stage = static_cast<uint8_t *>(heap_caps_calloc(PANEL_PIXELS, 3, MALLOC_CAP_SPIRAM));
+            committed = static_cast<uint8_t *>(heap_caps_calloc(PANEL_PIXELS, 3, MALLOC_CAP_SPIRAM));
+            staged = stage && committed;
+        }
+        return MatrixPanel_I2S_DMA::begin();
+    }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override
+    {
+        shadowPixel(x, y, color);
+        uint8_t r, g, b;
+        panelColor565(color, r, g, b);
+        if (staged)
+            stagePixel(x, y, r, g, b);
+        else
+            MatrixPanel_I2S_DMA::drawPixelRGB888(x, y, r, g, b);
+    }
+
+    void fillScreen(uint16_t color) override
+    {
+        shadowRect(0, 0, PANEL_WIDTH, PANEL_HEIGHT, color);
+        uint8_t r, g, b;
+        panelColor565(color, r, g, b);
+        if (staged)
+            stageRect(0, 0, PANEL_WIDTH, PANEL_HEIGHT, r, g, b);
+        else
+            MatrixPanel_I2S_DMA::fillScreenRGB888(r, g, b);
+    }
+
+    // The driver has fast paths for these that bypass drawPixel()
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override
+    {
+        shadowRect(x, y, w, h, color);
+        uint8_t r, g, b;
+        panelColor565(color, r, g, b);
+        if (staged)
+            stageRect(x, y, w, h, r, g, b);
+        else
+            MatrixPanel_I2S_DMA::fillRect(x, y, w, h, r, g, b);
+    }
+
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override
+    {
+        shadowRect(x, y, w, 1, color);
+        uint8_t r, g, b;
+        panelColor565(color, r, g, b);
+        if (staged)
+            stageRect(x, y, w, 1, r, g, b);
+        else
+            MatrixPanel_I2S_DMA::drawFastHLine(x, y, w, r, g, b);
+    }
+
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override
+    {
+        shadowRect(x, y, 1, h, color);
+        uint8_t r, g, b;
+        panelColor565(color, r, g, b);
+        if (staged)
+            stageRect(x, y, 1, h, r, g, b);
+        else
+            MatrixPanel_I2S_DMA::drawFastVLine(x, y, h, r, g, b);
+    }
+
+    void drawPixelRGB888(int16_t x, int16_t y, uint8_t r, uint8_t g, uint8_t b)
+    {
+        drawPanelPixel(x, y,
+                       panelLevelToByte(panelQuantize(panelGammaLut[0][r])),
+                       panelLevelToByte(panelQuantize(panelGammaLut[1][g])),
+                       panelLevelToByte(panelQuantize(panelGammaLut[2][b])),
+                       color565(r, g, b));
+    }
+
+    // Pixel already converted to driver bytes (e.g. dithered album art);
+    // sourceColor is what the mirror shows
+    void drawPanelPixel(int16_t x, int16_t y, uint8_t r, uint8_t g, uint8_t b, uint16_t sourceColor)
+    {
+        shadowPixel(x, y, sourceColor);
+        if (staged)
+            stagePixel(x, y, r, g, b);
+        else
+            MatrixPanel_I2S_DMA::drawPixelRGB888(x, y, r, g, b);
+    }
+
+    void clearScreen()
+    {
+        shadowRect(0, 0, PANEL_WIDTH, PANEL_HEIGHT, 0);
+        if (staged)
+            memset(stage, 0, PANEL_PIXELS * 3);
+        else
+            MatrixPanel_I2S_DMA::clearScreen();
+    }
+
+    void flipDMABuffer()
+    {
+        publishSnapshot();
+        if (staged)
+            commitStage();
+        else
+            MatrixPanel_I2S_DMA::flipDMABuffer();
+    }
+
+    bool isStaged() const { return staged; }
+
+    // Pixels written and time spent by the last single-buffer commit
+    uint32_t lastCommitPixels() const { return commitPixels; }
+    uint32_t lastCommitMicros() const { return commitMicros; }
+
+    // Copies the last flipped frame into dst (PANEL_PIXELS words) and returns
+    // its sequence number. Uses a seqlock, so the render path never waits on it.
+    uint32_t copySnapshot(uint16_t *dst) const
+    {
+        if (!front)
+            return 0;
+
+        uint32_t before, after;
+        do
+        {
+            before = sequence.load(std::memory_order_acquire);
+            if (before & 1)
+                continue;
+            memcpy(dst, front, PANEL_PIXELS * sizeof(uint16_t));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        return before >> 1;
+    }
+
+private:
+    uint16_t *back = nullptr;
+    uint16_t *front = nullptr;
+    std::atomic<uint32_t> sequence{0};
+
+    bool staged;
+    uint8_t *stage = nullptr;     // frame being drawn, driver bytes
+    uint8_t *committed = nullptr; // what the DMA buffer holds
+    uint32_t commitPixels = 0;
+    uint32_t commitMicros = 0;
+
+    inline void stagePixel(int16_t x, int16_t y, uint8_t r, uint8_t g, uint8_t b)
+    {
+        if (x >= 0 && y >= 0 && x < PANEL_WIDTH && y < PANEL_HEIGHT)
+        {
+            uint8_t *p = stage + (y * PANEL_WIDTH + x) * 3;
+            p[0] = r;
+            p[1] = g;
+            p[2] = b;
+        }
+    }
+
+    void stageRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t r, uint8_t g, uint8_t b)
+    {
+        int16_t x0 = std::max<int16_t>(x, 0);
+        int16_t y0 = std::max<int16_t>(y, 0);
+        int16_t x1 = std::min<int16_t>(x + w, PANEL_WIDTH);
+        int16_t y1 = std::min<int16_t>(y + h, PANEL_HEIGHT);
+
+        for (int16_t row = y0; row < y1; row++)
+        {
+            for (int16_t col = x0; col < x1; col++)
+            {
+                uint8_t *p = stage + (row * PANEL_WIDTH + col) * 3;
+                p[0] = r;
+                p[1] = g;
+                p[2] = b;
+            }
+        }
+    }
+
+    // A steady frame (clock minute unchanged) commits nothing
+    void commitStage()
+    {
+        uint32_t start = micros();
+        uint32_t written = 0;
+
+        for (int i = 0; i < PANEL_PIXELS; i++)
+        {
+            const uint8_t *s = stage + i * 3;
+            uint8_t *c = committed + i * 3;
+            if (s[0] == c[0] && s[1] == c[1] && s[2] == c[2])
+                continue;
+
+            MatrixPanel_I2S_DMA::drawPixelRGB888(i % PANEL_WIDTH, i / PANEL_WIDTH, s[0], s[1], s[2]);
+            c[0] = s[0];
+            c[1] = s[1];
+            c[2] = s[2];
+            written++;
+        }
+
+        commitPixels = written;
+        commitMicros = micros() - start;
+    }
+
+    inline void shadowPixel(int16_t x, int16_t y, uint16_t color)
+    {
+        if (back && x >= 0 && y >= 0 && x < PANEL_WIDTH && y < PANEL_HEIGHT)
+            back[y * PANEL_WIDTH + x] = color;
+    }
+
+    void shadowRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+    {
+        if (!back)
+            return;
+
+        int16_t x0 = std::max<int16_t>(x, 0);
+        int16_t y0 = std::max<int16_t>(y, 0);
+        int16_t x1 = std::min<int16_t>(x + w, PANEL_WIDTH);
+        int16_t y1 = std::min<int16_t>(y + h, PANEL_HEIGHT);
+        if (x0 >= x1)
+            return;
+
+        for (int16_t row = y0; row < y1; row++)
+        {
+            std::fill(back + row * PANEL_WIDTH + x0, back + row * PANEL_WIDTH + x1, color);
+        }
+    }
+
+    void publishSnapshot()
+    {
+        if (!back)
+            return;
+
+        uint32_t s = sequence.load(std::memory_order_relaxed);
+        sequence.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(front, back, PANEL_PIXELS * sizeof(uint16_t));
+        sequence.store(s + 2, std::memory_order_release);
+    }
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SpotifyEsp32.h>
+#include "config.h"
+
+// Request counters and track-change latency for the Spotify poll loop.
+// Latency runs from the start of the poll that saw a new track or cover to the
+// first flipped frame showing it, split into request, download and decode.
+// Requests and changes are counted on the net task, frames on the render task.
+// A summary is logged every SPOTIFY_STATS_REPORT_MS.
+//
+// With SPOTIFY_MOCK_HOST set, currently-playing requests and token refreshes
+// go to tools/mock_spotify.py on that host instead of the Spotify API, and
+// each request reports the last track change back to it in an X-Clock-Change
+// header (count,latency,request,download,decode in ms). The mock scripts
+// slow, truncated and failing replies and prints a latency table per
+// scenario.
+
+#ifndef SPOTIFY_STATS_REPORT_MS
+#define SPOTIFY_STATS_REPORT_MS 60000
+#endif
+#ifndef SPOTIFY_MOCK_PORT
+#define SPOTIFY_MOCK_PORT 8080
+#endif
+
+#define SPOTIFY_LATENCY_BUCKETS 16 // bucket n holds latencies below 2^(n+4) ms
+
+struct SpotifyStats
+{
+    uint32_t requests;
+    uint32_t ok;
+    uint32_t noContent;
+    uint32_t unauthorized;
+    uint32_t rateLimited;
+    uint32_t timeouts;
+    uint32_t otherErrors;
+    uint32_t tokenRefreshes;
+    uint64_t requestMicrosTotal;
+    uint32_t requestMicrosMax;
+
+    uint32_t trackChanges;
+    uint32_t latencyMsMax;
+    uint16_t latencyHistogram[SPOTIFY_LATENCY_BUCKETS];
+};
+
+// Calls sp.currently_playing(), or the mock server, and counts the reply
+response spotifyStatsCurrentlyPlaying(Spotify &sp);
+
+// Calls sp.get_access_token(), or the mock server's token endpoint
+void spotifyStatsRefreshToken(Spotify &sp);
+
+// Net task: the poll that started at pollStartMs found a new track or cover,
+// which went out to the render task in the snapshot numbered sequence
+void spotifyStatsChangeBegin(uint32_t pollStartMs, uint32_t requestMs);
+void spotifyStatsChangeStages(uint32_t downloadMs, uint32_t decodeMs);
+void spotifyStatsChangePublished(uint32_t sequence);
+
+// Render task: call after every flip with the sequence of the snapshot on
+// screen; closes a pending change and logs the periodic summary
+void spotifyStatsFramePresented(uint32_t sequence);
+
+SpotifyStats spotifyStats();
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Change detection for the poll compare: each poll hashes the cover URL and
+// track id of the reply instead of keeping String copies, so a steady poll
+// touches no heap. 0 is kept free to mean "nothing yet".
+
+// FNV-1a
+static inline uint32_t hashString(const char *text)
+{
+    uint32_t hash = 2166136261u;
+    while (*text)
+    {
+        hash ^= static_cast<uint8_t>(*text++);
+        hash *= 16777619u;
+    }
+    return hash ? hash : 1;
+}
+
+// Stores the hash of `text` in `hash` and returns whether it changed
+static inline bool hashUpdate(uint32_t &hash, const char *text)
+{
+    uint32_t next = hashString(text);
+    bool changed = next != hash;
+    hash = next;
+    return changed;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+#include <time.h>
+#include "config.h"
+
+// Wall clock for the render path that never blocks.
+//
+// Time is kept as a monotonic esp_timer count anchored to the last SNTP sync
+// and corrected by the measured oscillator drift, so it never steps backwards
+// between syncs. Until the first sync it starts from the RTC, which keeps
+// counting across a software reset. After a power cycle nothing is shown
+// until SNTP answers: the last good time saved in NVS only serves as a floor
+// that rejects an unset RTC or a bogus SNTP reply. If the saved time itself
+// was wrong (ahead), TIME_FLOOR_OVERRIDE_SYNCS rejected replies that agree
+// with each other win: the time is accepted and the saved floor rewritten.
+// Broken-down local time is cached and only recomputed when the second or
+// minute changes.
+//
+// timeLocal() and msUntilNextMinute() are meant for the loop task,
+// timeServiceUpdate() for the net task, since an NVS write can stall for a
+// flash erase.
+
+#ifndef TIME_SAVE_INTERVAL_MS
+#define TIME_SAVE_INTERVAL_MS 3600000 // how often a synced time is written to NVS
+#endif
+#ifndef TIME_FLOOR_OVERRIDE_SYNCS
+#define TIME_FLOOR_OVERRIDE_SYNCS 3 // agreeing replies older than the floor that replace it
+#endif
+#ifndef TIME_FLOOR_AGREE_MS
+#define TIME_FLOOR_AGREE_MS 10000 // how closely those replies must agree
+#endif
+
+enum TimeQuality : uint8_t
+{
+    TIME_UNSET,    // nothing to show yet
+    TIME_RESTORED, // from the RTC after a software reset, not confirmed by SNTP since boot
+    TIME_SYNCED,
+};
+
+struct TimeStatus
+{
+    TimeQuality quality;
+    uint32_t syncCount;
+    uint32_t syncAgeMs;   // since the last SNTP sync, 0 if none
+    int32_t driftPpb;     // estimated oscillator error, parts per billion
+    int32_t lastOffsetMs; // correction applied by the last sync
+    uint32_t rejectedSyncs; // SNTP replies older than the saved floor
+    uint32_t floorOverrides; // times those replies replaced the floor
+};
+
+// Sets the time zone, starts SNTP and restores the last known time
+void timeServiceBegin();
+
+// Housekeeping for the net task: sync logs and the periodic NVS save
+void timeServiceUpdate();
+
+// Current local time; false while the time is unknown
+bool timeLocal(struct tm &out);
+
+// Milliseconds until the displayed minute changes, or `fallback` when unknown
+uint32_t msUntilNextMinute(uint32_t fallback);
+
+TimeStatus timeStatus();
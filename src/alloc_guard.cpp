@@ -0,0 +1,118 @@
+#include <alloc_guard.h>
+#include <log.h>
+
+#ifdef ALLOC_GUARD
+
+#include <atomic>
+
+extern "C" void *__real_malloc(size_t size);
+extern "C" void *__real_calloc(size_t count, size_t size);
+extern "C" void *__real_realloc(void *ptr, size_t size);
+
+struct AllocGuardSlot
+{
+    std::atomic<TaskHandle_t> task;
+    std::atomic<uint32_t> allocations;
+};
+
+static AllocGuardSlot slots[ALLOC_GUARD_TASKS];
+static std::atomic<uint8_t> slotsInUse{0};
+static std::atomic<uint32_t> violations{0};
+
+static AllocGuardSlot *findSlot(TaskHandle_t task)
+{
+    for (AllocGuardSlot &slot : slots)
+    {
+        if (slot.task.load(std::memory_order_relaxed) == task)
+            return &slot;
+    }
+    return nullptr;
+}
+
+static inline void countAllocation()
+{
+    if (slotsInUse.load(std::memory_order_relaxed) == 0)
+        return;
+
+    AllocGuardSlot *slot = findSlot(xTaskGetCurrentTaskHandle());
+    if (slot)
+        slot->allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+extern "C" void *__wrap_malloc(size_t size)
+{
+    countAllocation();
+    return __real_malloc(size);
+}
+
+extern "C" void *__wrap_calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return __real_calloc(count, size);
+}
+
+extern "C" void *__wrap_realloc(void *ptr, size_t size)
+{
+    countAllocation();
+    return __real_realloc(ptr, size);
+}
+
+AllocGuard::AllocGuard(const char *section) : section(section)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    slot = findSlot(self);
+    outermost = slot == nullptr;
+
+    for (int i = 0; outermost && !slot && i < ALLOC_GUARD_TASKS; i++)
+    {
+        TaskHandle_t expected = nullptr;
+        if (slots[i].task.compare_exchange_strong(expected, self))
+        {
+            slot = &slots[i];
+            slot->allocations.store(0);
+            slotsInUse.fetch_add(1);
+        }
+    }
+
+    if (!slot)
+    {
+        LOG_EVERY_MS(60000, LOG_W("No alloc guard slot for %s", section));
+        startCount = 0;
+        return;
+    }
+    startCount = slot->allocations.load();
+}
+
+AllocGuard::~AllocGuard()
+{
+    if (!slot)
+        return;
+
+    uint32_t allocations = slot->allocations.load() - startCount;
+    if (outermost)
+    {
+        slotsInUse.fetch_sub(1);
+        slot->task.store(nullptr);
+    }
+
+    if (allocations == 0)
+        return;
+
+    violations.fetch_add(1);
+#ifdef ALLOC_GUARD_FATAL
+    // A queued log record would never be drained after abort(), so this one
+    // goes straight to the serial port
+    Serial.printf("%" PRIu32 " heap allocations in %s, aborting\n", allocations, section);
+    Serial.flush();
+    abort();
+#else
+    LOG_E("%" PRIu32 " heap allocations in %s", allocations, section);
+#endif
+}
+
+uint32_t allocGuardViolations()
+{
+    return violations.load();
+}
+
+#endif
@@ -0,0 +1,126 @@
+#include <backdrop.h>
+#include <log.h>
+
+#define BACKDROP_WINDOW (2 * CLOCK_BACKDROP_BLUR_RADIUS + 1)
+// (sum * BACKDROP_RECIPROCAL) >> 16 divides by the window without a divide;
+// rounding the reciprocal up keeps a full-white window at 255
+#define BACKDROP_RECIPROCAL ((65536 + BACKDROP_WINDOW - 1) / BACKDROP_WINDOW)
+// Each pass reads one radius further out, so the work area grows by this much
+#define BACKDROP_REACH (CLOCK_BACKDROP_BLUR_RADIUS * CLOCK_BACKDROP_PASSES)
+
+static_assert(CLOCK_BACKDROP_BLUR_RADIUS >= 1 && CLOCK_BACKDROP_BLUR_RADIUS <= 15, "CLOCK_BACKDROP_BLUR_RADIUS must be 1..15");
+static_assert(CLOCK_BACKDROP_DIM >= 0 && CLOCK_BACKDROP_DIM <= 256, "CLOCK_BACKDROP_DIM must be 0..256");
+
+static int imageWidth = 0;
+static int imageHeight = 0;
+static uint8_t *original = nullptr; // untouched copy of the work area
+static uint8_t *line = nullptr;     // one row or column being blurred
+
+// One box pass over `count` pixels spaced `stride` bytes apart, writing back
+// [begin, end). Reads beyond the image repeat the edge pixel.
+static void boxPass(uint8_t *pixels, int count, int stride, int begin, int end)
+{
+    const int r = CLOCK_BACKDROP_BLUR_RADIUS;
+
+    for (int i = 0; i < count; i++)
+    {
+        line[i * 3 + 0] = pixels[i * stride + 0];
+        line[i * 3 + 1] = pixels[i * stride + 1];
+        line[i * 3 + 2] = pixels[i * stride + 2];
+    }
+
+    for (int c = 0; c < 3; c++)
+    {
+        uint32_t sum = 0;
+        for (int k = begin - r; k <= begin + r; k++)
+            sum += line[std::min(std::max(k, 0), count - 1) * 3 + c];
+
+        for (int i = begin; i < end; i++)
+        {
+            pixels[i * stride + c] = (sum * BACKDROP_RECIPROCAL) >> 16;
+            sum += line[std::min(i + r + 1, count - 1) * 3 + c];
+            sum -= line[std::max(i - r, 0) * 3 + c];
+        }
+    }
+}
+
+// 0..256 along one axis: full inside [begin, end), fading over the feather
+static inline uint32_t featherWeight(int i, int begin, int end)
+{
+    int distance = i < begin ? begin - i : (i >= end ? i - end + 1 : 0);
+    if (distance > CLOCK_BACKDROP_FEATHER)
+        return 0;
+    return 256 * (CLOCK_BACKDROP_FEATHER + 1 - distance) / (CLOCK_BACKDROP_FEATHER + 1);
+}
+
+bool backdropBegin(int width, int height)
+{
+    imageWidth = width;
+    imageHeight = height;
+    original = static_cast<uint8_t *>(heap_caps_malloc(width * height * 3, MALLOC_CAP_SPIRAM));
+    line = static_cast<uint8_t *>(malloc(std::max(width, height) * 3));
+    if (!original || !line)
+    {
+        LOG_E("Not enough memory for the clock backdrop");
+        return false;
+    }
+    return true;
+}
+
+uint32_t backdropApply(uint8_t *rgb, BackdropRegion region)
+{
+    if (!original || !line)
+        return 0;
+
+    uint32_t start = micros();
+
+    // Full effect over the text and margin
+    int x0 = region.x - CLOCK_BACKDROP_MARGIN;
+    int y0 = region.y - CLOCK_BACKDROP_MARGIN;
+    int x1 = region.x + region.w + CLOCK_BACKDROP_MARGIN;
+    int y1 = region.y + region.h + CLOCK_BACKDROP_MARGIN;
+
+    // Work area: effect plus feather, plus what the blur reads around it
+    int spread = CLOCK_BACKDROP_FEATHER + BACKDROP_REACH;
+    int wx0 = std::max(x0 - spread, 0);
+    int wy0 = std::max(y0 - spread, 0);
+    int wx1 = std::min(x1 + spread, imageWidth);
+    int wy1 = std::min(y1 + spread, imageHeight);
+    if (wx0 >= wx1 || wy0 >= wy1)
+        return 0;
+
+    const int stride = imageWidth * 3;
+    const int rowBytes = (wx1 - wx0) * 3;
+    for (int y = wy0; y < wy1; y++)
+        memcpy(original + (y - wy0) * rowBytes, rgb + y * stride + wx0 * 3, rowBytes);
+
+    for (int pass = 0; pass < CLOCK_BACKDROP_PASSES; pass++)
+    {
+        for (int y = wy0; y < wy1; y++)
+            boxPass(rgb + y * stride, imageWidth, 3, wx0, wx1);
+        for (int x = wx0; x < wx1; x++)
+            boxPass(rgb + x * 3, imageHeight, stride, wy0, wy1);
+    }
+
+    // Blend blurred and original by the feather weight and dim by the same
+    // weight; pixels outside the feather get their original values back
+    for (int y = wy0; y < wy1; y++)
+    {
+        uint32_t weightY = featherWeight(y, y0, y1);
+        uint8_t *dst = rgb + y * stride + wx0 * 3;
+        const uint8_t *src = original + (y - wy0) * rowBytes;
+
+        for (int x = wx0; x < wx1; x++, dst += 3, src += 3)
+        {
+            uint32_t weight = (weightY * featherWeight(x, x0, x1)) >> 8;
+            uint32_t keep = 256 - ((weight * (256 - CLOCK_BACKDROP_DIM)) >> 8);
+            for (int c = 0; c < 3; c++)
+            {
+                uint32_t mixed = (src[c] * (256 - weight) + dst[c] * weight) >> 8;
+                dst[c] = (mixed * keep) >> 8;
+            }
+        }
+    }
+
+    return micros() - start;
+}
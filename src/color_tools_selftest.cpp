@@ -0,0 +1,82 @@
+#include <color_tools.h>
+
+#ifdef COLOR_TOOLS_SELFTEST
+
+#include <log.h>
+
+#define SELFTEST_PIXELS 4096
+#define SELFTEST_ROUNDS 50
+
+template <typename F>
+static uint32_t benchmarkMicros(F kernel)
+{
+  uint32_t start = micros();
+  for (int i = 0; i < SELFTEST_ROUNDS; i++)
+    kernel();
+  return std::max<uint32_t>(micros() - start, 1);
+}
+
+static void logThroughput(const char *name, uint32_t micros)
+{
+  // pixels per millisecond == kilopixels per second
+  LOG_I("color_tools %s: %lu kpx/s", name, (unsigned long)((uint64_t)SELFTEST_PIXELS * SELFTEST_ROUNDS * 1000 / micros));
+}
+
+bool colorToolsSelfTest()
+{
+  uint16_t *src = static_cast<uint16_t *>(heap_caps_malloc((SELFTEST_PIXELS + 1) * sizeof(uint16_t), MALLOC_CAP_SPIRAM));
+  uint16_t *out565a = static_cast<uint16_t *>(heap_caps_malloc((SELFTEST_PIXELS + 1) * sizeof(uint16_t), MALLOC_CAP_SPIRAM));
+  uint16_t *out565b = static_cast<uint16_t *>(heap_caps_malloc((SELFTEST_PIXELS + 1) * sizeof(uint16_t), MALLOC_CAP_SPIRAM));
+  uint8_t *out888a = static_cast<uint8_t *>(heap_caps_malloc(SELFTEST_PIXELS * 3, MALLOC_CAP_SPIRAM));
+  uint8_t *out888b = static_cast<uint8_t *>(heap_caps_malloc(SELFTEST_PIXELS * 3, MALLOC_CAP_SPIRAM));
+  bool ok = src && out565a && out565b && out888a && out888b;
+
+  if (ok)
+  {
+    for (int i = 0; i <= SELFTEST_PIXELS; i++)
+      src[i] = random(0x10000);
+
+#if COLOR_TOOLS_SWAR
+    // Both alignments, odd and even lengths
+    for (int offset = 0; offset < 2 && ok; offset++)
+    {
+      size_t count = SELFTEST_PIXELS - offset;
+      rgb565ToRgb888BufferPortable(src + offset, out888a, count);
+      rgb565ToRgb888BufferSwar(src + offset, out888b, count);
+      ok &= memcmp(out888a, out888b, count * 3) == 0;
+
+      for (uint16_t scale : {0, 1, 77, 128, 255, 256})
+      {
+        scaleBrightnessBufferPortable(src + offset, out565a + offset, count, scale);
+        scaleBrightnessBufferSwar(src + offset, out565b + offset, count, scale);
+        ok &= memcmp(out565a + offset, out565b + offset, count * sizeof(uint16_t)) == 0;
+      }
+    }
+    LOG_I("color_tools SWAR vs portable: %s", ok ? "bit-exact" : "MISMATCH");
+
+    logThroughput("rgb565->888 swar", benchmarkMicros([&] { rgb565ToRgb888BufferSwar(src, out888b, SELFTEST_PIXELS); }));
+    logThroughput("brightness swar", benchmarkMicros([&] { scaleBrightnessBufferSwar(src, out565b, SELFTEST_PIXELS, 128); }));
+#endif
+
+    logThroughput("rgb565->888", benchmarkMicros([&] { rgb565ToRgb888BufferPortable(src, out888a, SELFTEST_PIXELS); }));
+    logThroughput("rgb888->565", benchmarkMicros([&] { rgb888ToRgb565BufferPortable(out888a, out565a, SELFTEST_PIXELS); }));
+    logThroughput("brightness", benchmarkMicros([&] { scaleBrightnessBufferPortable(src, out565a, SELFTEST_PIXELS, 128); }));
+    logThroughput("vibrancy", benchmarkMicros([&] { vibrancyBuffer(src, out565a, SELFTEST_PIXELS); }));
+
+    uint32_t red[32] = {}, green[64] = {}, blue[32] = {};
+    logThroughput("histogram", benchmarkMicros([&] { channelHistogram(src, SELFTEST_PIXELS, red, green, blue); }));
+  }
+  else
+  {
+    LOG_E("color_tools self test: not enough memory");
+  }
+
+  heap_caps_free(src);
+  heap_caps_free(out565a);
+  heap_caps_free(out565b);
+  heap_caps_free(out888a);
+  heap_caps_free(out888b);
+  return ok;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#include <cover_ingest.h>
+#include <log.h>
+#include <LittleFS.h>
+
+static JPEGDEC jpeg;
+static uint8_t *fileBuffer = nullptr; // NET_MAX_COVER_BYTES in PSRAM
+
+static const char *const resultNames[COVER_RESULT_COUNT] = {
+    "ok",
+    "no file",
+    "too large",
+    "malformed",
+    "unsupported",
+    "too many pixels",
+    "decode failed",
+};
+
+const char *coverIngestResultName(CoverIngestResult result)
+{
+    return result < COVER_RESULT_COUNT ? resultNames[result] : "?";
+}
+
+bool coverIngestBegin()
+{
+    fileBuffer = static_cast<uint8_t *>(heap_caps_malloc(NET_MAX_COVER_BYTES, MALLOC_CAP_SPIRAM));
+    if (!fileBuffer)
+    {
+        LOG_E("Not enough PSRAM for the cover file buffer");
+        return false;
+    }
+    return true;
+}
+
+CoverIngestResult coverIngestDecodeBuffer(uint8_t *data, size_t length, JPEG_DRAW_CALLBACK *draw)
+{
+    JpegFrameInfo info;
+    CoverIngestResult result = jpegReadFrameInfo(data, length, info);
+    if (result != COVER_OK)
+        return result;
+
+    if (!jpeg.openRAM(data, (int)length, draw))
+        return COVER_DECODE_FAILED;
+
+    // Both parsers must agree on what is about to be decoded
+    if (jpeg.getWidth() != info.width || jpeg.getHeight() != info.height)
+    {
+        jpeg.close();
+        return COVER_MALFORMED;
+    }
+
+    jpeg.setPixelType(RGB8888);
+    bool decoded = jpeg.decode(0, 0, 0); // 0 = full size
+    jpeg.close();
+
+    return decoded ? COVER_OK : COVER_DECODE_FAILED;
+}
+
+CoverIngestResult coverIngestDecode(const char *filename, JPEG_DRAW_CALLBACK *draw)
+{
+    if (!fileBuffer)
+        return COVER_DECODE_FAILED;
+
+    File file = LittleFS.open(filename, "r");
+    if (!file)
+        return COVER_NO_FILE;
+
+    size_t size = file.size();
+    if (size > NET_MAX_COVER_BYTES)
+    {
+        file.close();
+        LOG_W("Cover is %u bytes, limit %u", size, NET_MAX_COVER_BYTES);
+        return COVER_TOO_LARGE;
+    }
+
+    size_t readBytes = file.read(fileBuffer, size);
+    file.close();
+    if (size == 0 || readBytes != size)
+        return COVER_MALFORMED;
+
+    return coverIngestDecodeBuffer(fileBuffer, size, draw);
+}
@@ -0,0 +1,87 @@
+#include <cover_ingest.h>
+
+#ifdef COVER_INGEST_SELFTEST
+
+#include <log.h>
+#include <LittleFS.h>
+
+#define SELFTEST_TRUNCATIONS 64
+#define SELFTEST_MUTATIONS 256
+#define SELFTEST_DECODE_ROUNDS 20
+
+// On-device stand-in for a fuzzer: every input must come back with a result
+// instead of crashing or hanging, and the slowest one shows the worst case a
+// hostile file can cost the render loop
+void coverIngestSelfTest(const char *filename, JPEG_DRAW_CALLBACK *draw, void (*reset)())
+{
+    File file = LittleFS.open(filename, "r");
+    if (!file)
+    {
+        LOG_I("cover_ingest self test skipped, no cached cover yet");
+        return;
+    }
+
+    size_t length = std::min<size_t>(file.size(), NET_MAX_COVER_BYTES);
+    uint8_t *original = static_cast<uint8_t *>(heap_caps_malloc(length, MALLOC_CAP_SPIRAM));
+    uint8_t *input = static_cast<uint8_t *>(heap_caps_malloc(length, MALLOC_CAP_SPIRAM));
+    if (length < 4 || !original || !input || file.read(original, length) != length)
+    {
+        LOG_E("cover_ingest self test: could not load %s", filename);
+        file.close();
+        heap_caps_free(original);
+        heap_caps_free(input);
+        return;
+    }
+    file.close();
+
+    uint32_t results[COVER_RESULT_COUNT] = {};
+    uint32_t slowestMicros = 0;
+    auto run = [&](size_t size)
+    {
+        uint32_t start = micros();
+        CoverIngestResult result = coverIngestDecodeBuffer(input, size, draw);
+        slowestMicros = std::max<uint32_t>(slowestMicros, micros() - start);
+        results[result]++;
+        reset();
+    };
+
+    // Throughput on the intact file
+    JpegFrameInfo info;
+    memcpy(input, original, length);
+    CoverIngestResult intact = jpegReadFrameInfo(input, length, info);
+    uint32_t start = micros();
+    for (int i = 0; i < SELFTEST_DECODE_ROUNDS; i++)
+        coverIngestDecodeBuffer(input, length, draw);
+    uint32_t decodeMicros = std::max<uint32_t>((micros() - start) / SELFTEST_DECODE_ROUNDS, 1);
+    reset(); // same colors every round, so nothing piled up while timing
+    LOG_I("cover_ingest %ux%u, %u bytes (%s): %" PRIu32 " us per decode, %lu kpx/s",
+          info.width, info.height, length, coverIngestResultName(intact), decodeMicros,
+          (unsigned long)((uint64_t)info.width * info.height * 1000 / decodeMicros));
+
+    // Every prefix length class, so each marker gets cut in half somewhere
+    for (int i = 0; i < SELFTEST_TRUNCATIONS; i++)
+        run(length * i / SELFTEST_TRUNCATIONS);
+
+    // A few random bytes replaced, biased towards the headers
+    for (int i = 0; i < SELFTEST_MUTATIONS; i++)
+    {
+        memcpy(input, original, length);
+        int flips = 1 + random(8);
+        for (int f = 0; f < flips; f++)
+        {
+            size_t at = random(2) ? random(std::min<size_t>(length, 1024)) : random(length);
+            input[at] = random(4) ? random(256) : 0xFF;
+        }
+        run(length);
+    }
+
+    LOG_I("cover_ingest mutated inputs: ok %" PRIu32 ", malformed %" PRIu32 ", unsupported %" PRIu32 ", too many pixels %" PRIu32 ", decode failed %" PRIu32,
+          results[COVER_OK], results[COVER_MALFORMED], results[COVER_UNSUPPORTED],
+          results[COVER_TOO_MANY_PIXELS], results[COVER_DECODE_FAILED]);
+    LOG_I("cover_ingest slowest input: %" PRIu32 " us", slowestMicros);
+
+    heap_caps_free(original);
+    heap_caps_free(input);
+}
+
+#endif
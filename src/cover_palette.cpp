@@ -0,0 +1,83 @@
+#include <cover_palette.h>
+#include <color_tools.h>
+#include <log.h>
+#include <algorithm>
+#include <vector>
+
+void coverPaletteStoreBlock(uint8_t *rgb, int width, int height, const uint32_t *pixels, int x, int y,
+                            int blockWidth, int blockHeight, ColorCounts &counts)
+{
+    int x0 = std::max(0, -x);
+    int y0 = std::max(0, -y);
+    int x1 = std::min(blockWidth, width - x);
+    int y1 = std::min(blockHeight, height - y);
+
+    for (int by = y0; by < y1; by++)
+    {
+        for (int bx = x0; bx < x1; bx++)
+        {
+            uint32_t pixel = pixels[by * blockWidth + bx];
+            uint8_t r = pixel & 0xFF;
+            uint8_t g = (pixel >> 8) & 0xFF;
+            uint8_t b = (pixel >> 16) & 0xFF;
+
+            uint8_t *dst = rgb + ((by + y) * width + bx + x) * 3;
+            dst[0] = r;
+            dst[1] = g;
+            dst[2] = b;
+
+            // Count the occurrences of each color
+            counts[rgb8ToRgb565(r, g, b)]++;
+        }
+    }
+}
+
+uint16_t extractMostVibrantColor(const ColorCounts &counts)
+{
+    std::vector<uint16_t, PSRAMAllocator<uint16_t>> colors;
+    colors.reserve(counts.size());
+    for (const auto &entry : counts)
+    {
+        colors.push_back(entry.first);
+    }
+
+    std::vector<uint16_t, PSRAMAllocator<uint16_t>> scores(colors.size());
+    vibrancyBuffer(colors.data(), scores.data(), colors.size());
+
+    // First maximum wins, as with the ordered map iteration before
+    size_t best = std::max_element(scores.begin(), scores.end()) - scores.begin();
+    return best < colors.size() ? colors[best] : 0;
+}
+
+bool coverPaletteExtract(const ColorCounts &counts, CoverPalette &palette)
+{
+    if (counts.empty())
+        return false;
+
+    // Find the least and most predominant colors
+    auto minmax = std::minmax_element(
+        counts.begin(), counts.end(),
+        [](const ColorCounts::value_type &a, const ColorCounts::value_type &b)
+        {
+            return a.second < b.second;
+        });
+
+    palette.mostCommon = minmax.second->first;
+    palette.leastCommon = minmax.first->first;
+    palette.primary = palette.mostCommon;
+    palette.secondary = palette.leastCommon;
+
+    // Too close to tell apart: the most vibrant color, or else the inverse
+    if (areColorsSimilar(palette.primary, palette.secondary, COLOR_SIMILARITY_THRESHOLD))
+    {
+        LOG_D("Most predominant color is similar to least predominant color");
+        palette.secondary = extractMostVibrantColor(counts);
+
+        if (areColorsSimilar(palette.primary, palette.secondary, COLOR_SIMILARITY_THRESHOLD))
+        {
+            LOG_D("Invert color");
+            palette.secondary = invertColor(palette.primary);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,374 @@
+#include <fleet.h>
+#include <log.h>
+#include <power_profile.h>
+#include <AsyncUDP.h>
+#include <ESPmDNS.h>
+
+#define FLEET_MAGIC 0x31464353 // "SCF1"
+
+enum FleetPacketType : uint8_t
+{
+    FLEET_PACKET_NOW_PLAYING = 1,
+    FLEET_PACKET_COVER = 2,
+};
+
+struct __attribute__((packed)) FleetHeader
+{
+    uint32_t magic;
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t length; // payload bytes after the header
+    uint32_t sender;
+};
+
+struct __attribute__((packed)) FleetNowPlayingPacket
+{
+    uint32_t sequence;
+    uint32_t trackHash;
+    uint32_t coverHash;
+    uint16_t primaryColor;
+    uint16_t secondaryColor;
+    uint8_t playing;
+    uint8_t urlLength;
+    uint16_t textLength;
+    // followed by the URL and the text, neither terminated
+};
+
+struct __attribute__((packed)) FleetCoverPacket
+{
+    uint32_t coverHash;
+    uint16_t index;
+    uint16_t count;
+    // followed by up to FLEET_COVER_CHUNK_BYTES pixel bytes
+};
+
+static AsyncUDP udp;
+static const IPAddress group(FLEET_MULTICAST_GROUP);
+static SemaphoreHandle_t lock = nullptr;
+static TaskHandle_t sendTask = nullptr;
+static uint32_t nodeId = 0;
+static FleetElection election = {};
+
+// Leader side
+static FleetNowPlaying published = {};
+static bool publishedValid = false;
+static uint8_t *sendCover = nullptr;
+static uint32_t sendCoverHash = 0;
+static uint32_t lastCoverSendMs = 0;
+static bool stateDirty = false; // changed since the send task last ran
+static bool coverDirty = false;
+
+// Follower side
+static FleetNowPlaying received = {};
+static uint8_t *assembly = nullptr;
+static uint32_t assemblyHash = 0;
+static uint32_t assemblyMask = 0;
+
+static size_t coverSize = 0;
+static uint16_t coverChunks = 0;
+
+static void sendNowPlaying()
+{
+    uint8_t packet[sizeof(FleetHeader) + sizeof(FleetNowPlayingPacket) + FLEET_URL_MAX + MARQUEE_MAX_BYTES];
+    FleetHeader *header = reinterpret_cast<FleetHeader *>(packet);
+    FleetNowPlayingPacket *body = reinterpret_cast<FleetNowPlayingPacket *>(packet + sizeof(FleetHeader));
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    size_t urlLength = strnlen(published.coverUrl, FLEET_URL_MAX - 1);
+    size_t textLength = strnlen(published.text, MARQUEE_MAX_BYTES - 1);
+    body->sequence = published.sequence;
+    body->trackHash = published.trackHash;
+    body->coverHash = published.coverHash;
+    body->primaryColor = published.primaryColor;
+    body->secondaryColor = published.secondaryColor;
+    body->playing = published.playing;
+    body->urlLength = urlLength;
+    body->textLength = textLength;
+    uint8_t *tail = packet + sizeof(FleetHeader) + sizeof(FleetNowPlayingPacket);
+    memcpy(tail, published.coverUrl, urlLength);
+    memcpy(tail + urlLength, published.text, textLength);
+    xSemaphoreGive(lock);
+
+    size_t payload = sizeof(FleetNowPlayingPacket) + urlLength + textLength;
+    *header = {FLEET_MAGIC, FLEET_PACKET_NOW_PLAYING, 0, (uint16_t)payload, nodeId};
+    udp.writeTo(packet, sizeof(FleetHeader) + payload, group, FLEET_PORT);
+}
+
+static void sendCoverChunks()
+{
+    uint8_t packet[sizeof(FleetHeader) + sizeof(FleetCoverPacket) + FLEET_COVER_CHUNK_BYTES];
+    FleetHeader *header = reinterpret_cast<FleetHeader *>(packet);
+    FleetCoverPacket *body = reinterpret_cast<FleetCoverPacket *>(packet + sizeof(FleetHeader));
+
+    for (uint16_t i = 0; i < coverChunks; i++)
+    {
+        size_t offset = i * FLEET_COVER_CHUNK_BYTES;
+        size_t bytes = std::min<size_t>(FLEET_COVER_CHUNK_BYTES, coverSize - offset);
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        *body = {sendCoverHash, i, coverChunks};
+        memcpy(packet + sizeof(FleetHeader) + sizeof(FleetCoverPacket), sendCover + offset, bytes);
+        xSemaphoreGive(lock);
+
+        uint16_t payload = sizeof(FleetCoverPacket) + bytes;
+        *header = {FLEET_MAGIC, FLEET_PACKET_COVER, 0, payload, nodeId};
+        udp.writeTo(packet, sizeof(FleetHeader) + payload, group, FLEET_PORT);
+    }
+}
+
+static void onNowPlaying(uint32_t sender, const uint8_t *data, size_t length)
+{
+    if (length < sizeof(FleetNowPlayingPacket))
+        return;
+
+    FleetNowPlayingPacket body;
+    memcpy(&body, data, sizeof(body));
+    if (body.urlLength >= FLEET_URL_MAX || body.textLength >= MARQUEE_MAX_BYTES ||
+        sizeof(body) + body.urlLength + body.textLength > length)
+        return;
+
+    uint32_t now = millis();
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    uint32_t previous = election.heard ? election.leaderId : nodeId;
+    if (fleetElectionHeard(election, sender, now))
+    {
+        if (sender != previous)
+            LOG_I("Fleet leader is now %08lx", (unsigned long)sender);
+
+        received.sequence = body.sequence;
+        received.playing = body.playing;
+        received.trackHash = body.trackHash;
+        received.coverHash = body.coverHash;
+        received.primaryColor = body.primaryColor;
+        received.secondaryColor = body.secondaryColor;
+        const uint8_t *tail = data + sizeof(body);
+        memcpy(received.coverUrl, tail, body.urlLength);
+        received.coverUrl[body.urlLength] = '\0';
+        memcpy(received.text, tail + body.urlLength, body.textLength);
+        received.text[body.textLength] = '\0';
+    }
+
+    xSemaphoreGive(lock);
+}
+
+static void onCover(uint32_t sender, const uint8_t *data, size_t length)
+{
+    if (!assembly || length < sizeof(FleetCoverPacket))
+        return;
+
+    FleetCoverPacket body;
+    memcpy(&body, data, sizeof(body));
+    size_t offset = body.index * FLEET_COVER_CHUNK_BYTES;
+    size_t bytes = length - sizeof(body);
+    if (body.count != coverChunks || body.index >= coverChunks ||
+        bytes != std::min<size_t>(FLEET_COVER_CHUNK_BYTES, coverSize - offset))
+        return;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (election.heard && sender == election.leaderId)
+    {
+        if (body.coverHash != assemblyHash)
+        {
+            assemblyHash = body.coverHash;
+            assemblyMask = 0;
+        }
+        memcpy(assembly + offset, data + sizeof(body), bytes);
+        assemblyMask |= 1u << body.index;
+    }
+    xSemaphoreGive(lock);
+}
+
+static void onPacket(AsyncUDPPacket &packet)
+{
+    if (packet.length() < sizeof(FleetHeader))
+        return;
+
+    FleetHeader header;
+    memcpy(&header, packet.data(), sizeof(header));
+    if (header.magic != FLEET_MAGIC || header.sender == nodeId ||
+        header.length != packet.length() - sizeof(header))
+        return;
+
+    const uint8_t *payload = packet.data() + sizeof(header);
+    if (header.type == FLEET_PACKET_NOW_PLAYING)
+        onNowPlaying(header.sender, payload, header.length);
+    else if (header.type == FLEET_PACKET_COVER)
+        onCover(header.sender, payload, header.length);
+}
+
+// Sends whatever fleetPublish() and fleetPublishCover() marked, and the
+// heartbeat: the leader repeats its state so late joiners and lost packets
+// catch up. A leader whose polls stopped or keep failing goes quiet so
+// another takes over.
+static void fleetTask(void *)
+{
+    uint32_t lastHeartbeatMs = millis();
+    while (true)
+    {
+        uint32_t sinceHeartbeat = millis() - lastHeartbeatMs;
+        uint32_t wait = sinceHeartbeat < FLEET_HEARTBEAT_MS ? FLEET_HEARTBEAT_MS - sinceHeartbeat : 0;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+
+        uint32_t now = millis();
+        bool heartbeat = now - lastHeartbeatMs >= FLEET_HEARTBEAT_MS;
+        if (heartbeat)
+            lastHeartbeatMs = now;
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        bool leading = heartbeat && publishedValid &&
+                       fleetElectionShouldSend(election, now, powerProfilePollIntervalMs());
+        bool coverDue = sendCover && sendCoverHash && now - lastCoverSendMs >= FLEET_COVER_RESEND_MS;
+        bool sendState = stateDirty || leading;
+        bool sendCoverNow = coverDirty || (leading && coverDue);
+        stateDirty = false;
+        coverDirty = false;
+        if (sendCoverNow)
+            lastCoverSendMs = now;
+        xSemaphoreGive(lock);
+
+        if (sendState)
+            sendNowPlaying();
+        if (sendCoverNow)
+            sendCoverChunks();
+    }
+}
+
+bool fleetBegin(size_t coverBytes)
+{
+    nodeId = (uint32_t)ESP.getEfuseMac();
+    coverSize = coverBytes;
+    coverChunks = (coverBytes + FLEET_COVER_CHUNK_BYTES - 1) / FLEET_COVER_CHUNK_BYTES;
+    lock = xSemaphoreCreateMutex();
+    fleetElectionBegin(election, nodeId);
+
+    if (FLEET_SHARE_COVER && coverChunks <= 32)
+    {
+        sendCover = static_cast<uint8_t *>(heap_caps_calloc(coverBytes, 1, MALLOC_CAP_SPIRAM));
+        assembly = static_cast<uint8_t *>(heap_caps_calloc(coverBytes, 1, MALLOC_CAP_SPIRAM));
+    }
+
+    if (!lock || !udp.listenMulticast(group, FLEET_PORT))
+    {
+        LOG_E("Fleet: multicast listen failed");
+        return false;
+    }
+    udp.onPacket(onPacket);
+
+    // Advertise next to the http service and list the clocks already running
+    char id[9];
+    snprintf(id, sizeof(id), "%08lx", (unsigned long)nodeId);
+    MDNS.addService("spotclock", "udp", FLEET_PORT);
+    MDNS.addServiceTxt("spotclock", "udp", "id", id);
+
+    int peers = MDNS.queryService("spotclock", "udp");
+    LOG_I("Fleet: node %s, %d other clock(s) found", id, std::max(peers, 0));
+    for (int i = 0; i < peers && i < FLEET_MAX_PEERS; i++)
+    {
+        LOG_I("Fleet peer: %s (%s) id %s", MDNS.hostname(i).c_str(), MDNS.IP(i).toString().c_str(), MDNS.txt(i, "id").c_str());
+    }
+
+    if (xTaskCreatePinnedToCore(fleetTask, "fleet", 4096, nullptr, FLEET_TASK_PRIORITY, &sendTask, 0) != pdPASS)
+    {
+        LOG_E("Fleet: send task failed");
+        return false;
+    }
+    return true;
+}
+
+bool fleetIsFollower()
+{
+    if (!lock)
+        return false;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool follower = fleetElectionIsFollower(election, millis());
+    xSemaphoreGive(lock);
+    return follower;
+}
+
+uint32_t fleetNodeId()
+{
+    return nodeId;
+}
+
+void fleetPublish(const FleetNowPlaying &state)
+{
+    if (!lock)
+        return;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    fleetElectionPolled(election, true, millis());
+    bool changed = !publishedValid || state.playing != published.playing ||
+                   state.trackHash != published.trackHash || state.coverHash != published.coverHash ||
+                   state.primaryColor != published.primaryColor || state.secondaryColor != published.secondaryColor;
+    if (changed)
+    {
+        uint32_t sequence = published.sequence + 1;
+        published = state;
+        published.sequence = sequence;
+        publishedValid = true;
+        stateDirty = true;
+    }
+    xSemaphoreGive(lock);
+
+    if (changed && sendTask)
+        xTaskNotifyGive(sendTask);
+}
+
+void fleetPollFailed()
+{
+    if (!lock)
+        return;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    fleetElectionPolled(election, false, millis());
+    bool quiet = election.failedPolls == FLEET_QUIET_AFTER_FAILED_POLLS;
+    xSemaphoreGive(lock);
+
+    if (quiet)
+        LOG_W("Fleet: %d polls failed in a row, no longer leading", FLEET_QUIET_AFTER_FAILED_POLLS);
+}
+
+void fleetPublishCover(uint32_t coverHash, const uint8_t *pixels)
+{
+    if (!sendCover)
+        return;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    memcpy(sendCover, pixels, coverSize);
+    sendCoverHash = coverHash;
+    coverDirty = true;
+    xSemaphoreGive(lock);
+
+    if (sendTask)
+        xTaskNotifyGive(sendTask);
+}
+
+bool fleetLatest(FleetNowPlaying &state)
+{
+    if (!lock)
+        return false;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool valid = election.heard;
+    if (valid)
+        state = received;
+    xSemaphoreGive(lock);
+    return valid;
+}
+
+bool fleetTakeCover(uint32_t coverHash, uint8_t *pixels)
+{
+    if (!assembly)
+        return false;
+
+    uint32_t complete = coverChunks >= 32 ? 0xFFFFFFFFu : (1u << coverChunks) - 1;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool ready = assemblyHash == coverHash && assemblyMask == complete;
+    if (ready)
+        memcpy(pixels, assembly, coverSize);
+    xSemaphoreGive(lock);
+    return ready;
+}
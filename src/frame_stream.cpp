@@ -0,0 +1,156 @@
+#include <frame_stream.h>
+#include <frame_codec.h>
+#include <log.h>
+#include <ESPAsyncWebServer.h>
+
+static AsyncWebServer server(FRAME_STREAM_PORT);
+static AsyncWebSocket ws("/ws");
+
+static ShadowPanel *streamPanel = nullptr;
+static uint16_t *currentFrame = nullptr;   // snapshot being encoded
+static uint16_t *referenceFrame = nullptr; // last frame every client received
+static uint8_t *message = nullptr;
+static size_t messageCapacity = 0;
+
+static volatile bool keyframeRequested = true;
+static FrameStreamStats stats = {};
+
+static const char viewerPage[] PROGMEM = R"rawliteral(<!DOCTYPE html>
+<html><head><meta charset="utf-8"><title>Spotify Clock</title>
+<style>body{background:#111;color:#aaa;font:12px monospace;text-align:center}
+canvas{width:512px;height:512px;image-rendering:pixelated;margin-top:16px}</style></head>
+<body><canvas id="c"></canvas><div id="s">connecting...</div>
+<script>
+const c=document.getElementById('c'),s=document.getElementById('s'),ctx=c.getContext('2d');
+let frame=null,img=null,bytes=0,count=0,t0=performance.now();
+function connect(){
+  const ws=new WebSocket('ws://'+location.host+'/ws');ws.binaryType='arraybuffer';
+  ws.onclose=()=>{s.textContent='disconnected';setTimeout(connect,2000);};
+  ws.onmessage=(e)=>{
+    const d=new DataView(e.data),w=d.getUint8(1),h=d.getUint8(2),seq=d.getUint32(4,true);
+    if(!frame||frame.length!=w*h){frame=new Uint16Array(w*h);c.width=w;c.height=h;img=ctx.createImageData(w,h);}
+    if(d.getUint8(0)==75)frame.fill(0);
+    let i=0,p=8;
+    while(p<e.data.byteLength){const t=d.getUint16(p,true);p+=2;
+      if(t&0x8000){for(let n=t&0x7fff;n>0;n--,p+=2)frame[i++]^=d.getUint16(p,true);}else i+=t;}
+    for(let k=0;k<frame.length;k++){const v=frame[k],r=v>>11,g=(v>>5)&63,b=v&31;
+      img.data[k*4]=(r*255+15)/31|0;img.data[k*4+1]=(g*255+31)/63|0;img.data[k*4+2]=(b*255+15)/31|0;img.data[k*4+3]=255;}
+    ctx.putImageData(img,0,0);
+    bytes+=e.data.byteLength;count++;
+    const dt=(performance.now()-t0)/1000;
+    if(dt>1){s.textContent='frame '+seq+' | '+(count/dt).toFixed(1)+' fps | '+(bytes/dt/1024).toFixed(1)+' KiB/s';bytes=0;count=0;t0=performance.now();}
+  };
+}
+connect();
+</script></body></html>)rawliteral";
+
+static void onWebSocketEvent(AsyncWebSocket *, AsyncWebSocketClient *client, AwsEventType type, void *, uint8_t *, size_t)
+{
+    if (type == WS_EVT_CONNECT)
+    {
+        LOG_I("Frame stream client #%u connected", client->id());
+        keyframeRequested = true;
+    }
+    else if (type == WS_EVT_DISCONNECT)
+    {
+        LOG_I("Frame stream client #%u disconnected", client->id());
+    }
+}
+
+static void frameStreamTask(void *)
+{
+    const TickType_t period = pdMS_TO_TICKS(1000 / FRAME_STREAM_MAX_FPS);
+    // The bucket must hold at least one worst-case message or keyframes would never go out
+    const uint32_t bucketCapacity = std::max<uint32_t>(FRAME_STREAM_MAX_BYTES_PER_SEC, messageCapacity);
+
+    uint32_t bucket = bucketCapacity;
+    uint32_t lastRefill = millis();
+    uint32_t lastKeyframe = 0;
+    uint32_t lastSequence = 0;
+    TickType_t wake = xTaskGetTickCount();
+
+    for (;;)
+    {
+        vTaskDelayUntil(&wake, period);
+
+        uint32_t now = millis();
+        bucket = std::min<uint32_t>(bucketCapacity, bucket + (uint64_t)(now - lastRefill) * FRAME_STREAM_MAX_BYTES_PER_SEC / 1000);
+        lastRefill = now;
+
+        ws.cleanupClients();
+        if (ws.count() == 0)
+        {
+            keyframeRequested = true;
+            continue;
+        }
+
+        uint32_t sequence = streamPanel->copySnapshot(currentFrame);
+        bool keyframe = keyframeRequested || now - lastKeyframe >= FRAME_STREAM_KEYFRAME_INTERVAL_MS;
+        if (sequence == lastSequence && !keyframe)
+            continue;
+
+        uint32_t start = micros();
+        size_t length = encodeFrame(currentFrame, keyframe ? nullptr : referenceFrame,
+                                    PANEL_WIDTH, PANEL_HEIGHT, sequence, message, messageCapacity);
+        stats.lastEncodeMicros = micros() - start;
+
+        // Over budget: keep the old reference so the next delta carries these changes
+        if (length > bucket)
+        {
+            stats.framesSkipped++;
+            continue;
+        }
+
+        // A client that misses a delta is out of sync until the next keyframe
+        if (!ws.availableForWriteAll())
+        {
+            stats.framesSkipped++;
+            keyframeRequested = true;
+            continue;
+        }
+
+        ws.binaryAll(message, length);
+        memcpy(referenceFrame, currentFrame, PANEL_PIXELS * sizeof(uint16_t));
+
+        bucket -= length;
+        lastSequence = sequence;
+        stats.framesSent++;
+        stats.bytesSent += length;
+        if (keyframe)
+        {
+            stats.keyframesSent++;
+            lastKeyframe = now;
+            keyframeRequested = false;
+        }
+    }
+}
+
+bool frameStreamBegin(ShadowPanel *panel)
+{
+    streamPanel = panel;
+    messageCapacity = frameCodecMaxBytes(PANEL_PIXELS);
+
+    currentFrame = static_cast<uint16_t *>(heap_caps_malloc(PANEL_PIXELS * sizeof(uint16_t), MALLOC_CAP_SPIRAM));
+    referenceFrame = static_cast<uint16_t *>(heap_caps_malloc(PANEL_PIXELS * sizeof(uint16_t), MALLOC_CAP_SPIRAM));
+    message = static_cast<uint8_t *>(heap_caps_malloc(messageCapacity, MALLOC_CAP_SPIRAM));
+
+    if (!currentFrame || !referenceFrame || !message)
+    {
+        LOG_E("Frame stream: not enough memory");
+        return false;
+    }
+
+    ws.onEvent(onWebSocketEvent);
+    server.addHandler(&ws);
+    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request)
+              { request->send(200, "text/html", viewerPage); });
+    server.begin();
+
+    xTaskCreatePinnedToCore(frameStreamTask, "frameStream", 4096, nullptr, FRAME_STREAM_TASK_PRIORITY, nullptr, 0);
+    return true;
+}
+
+FrameStreamStats frameStreamStats()
+{
+    return stats;
+}
@@ -0,0 +1,93 @@
+#include <jpeg_header.h>
+
+static inline uint16_t readBigEndian16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+// Frame header body: precision, height, width, component count and one
+// (id, sampling, quantization table) triple per component
+static CoverIngestResult parseFrameHeader(const uint8_t *body, size_t length, JpegFrameInfo &info)
+{
+    if (length < 6)
+        return COVER_MALFORMED;
+
+    uint8_t precision = body[0];
+    info.height = readBigEndian16(body + 1);
+    info.width = readBigEndian16(body + 3);
+    info.components = body[5];
+
+    if (length < 6 + 3 * (size_t)info.components)
+        return COVER_MALFORMED;
+    if (info.width == 0)
+        return COVER_MALFORMED;
+    // Height 0 means it follows the scan (DNL marker), which JPEGDEC does not handle
+    if (precision != 8 || info.height == 0 || (info.components != 1 && info.components != 3))
+        return COVER_UNSUPPORTED;
+
+    for (int i = 0; i < info.components; i++)
+    {
+        const uint8_t *component = body + 6 + i * 3;
+        uint8_t horizontal = component[1] >> 4;
+        uint8_t vertical = component[1] & 0x0F;
+        if (component[2] > 3)
+            return COVER_MALFORMED;
+
+        // JPEGDEC handles 1x1, 2x1, 1x2 and 2x2 luma with unsubsampled chroma
+        uint8_t maxFactor = i == 0 ? 2 : 1;
+        if (horizontal < 1 || vertical < 1 || horizontal > maxFactor || vertical > maxFactor)
+            return COVER_UNSUPPORTED;
+    }
+
+    if (info.width > COVER_MAX_DIMENSION || info.height > COVER_MAX_DIMENSION)
+        return COVER_TOO_MANY_PIXELS;
+
+    return COVER_OK;
+}
+
+CoverIngestResult jpegReadFrameInfo(const uint8_t *data, size_t length, JpegFrameInfo &info)
+{
+    info = {};
+    if (length < 4 || data[0] != 0xFF || data[1] != 0xD8)
+        return COVER_MALFORMED;
+
+    size_t pos = 2;
+    while (pos + 4 <= length)
+    {
+        if (data[pos] != 0xFF)
+            return COVER_MALFORMED;
+
+        uint8_t marker = data[pos + 1];
+        if (marker == 0xFF)
+        {
+            pos++; // fill byte
+            continue;
+        }
+        pos += 2;
+
+        // Markers without a length
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+            continue;
+        // Scan data, a second image or the end before any frame header
+        if (marker == 0x00 || marker == 0xD8 || marker == 0xD9 || marker == 0xDA)
+            return COVER_MALFORMED;
+
+        size_t segment = readBigEndian16(data + pos);
+        if (segment < 2 || segment > length - pos)
+            return COVER_MALFORMED;
+
+        // SOF0 baseline, SOF1 extended and SOF2 progressive Huffman are
+        // decodable; C4 (DHT), C8 (JPG) and CC (DAC) are not frame headers
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+        {
+            if (marker > 0xC2)
+                return COVER_UNSUPPORTED; // lossless, hierarchical or arithmetic coded
+            info.progressive = marker == 0xC2;
+            return parseFrameHeader(data + pos + 2, segment - 2, info);
+        }
+
+        pos += segment;
+    }
+
+    return COVER_MALFORMED;
+}
@@ -0,0 +1,157 @@
+#include <log.h>
+#include <atomic>
+#include <stdarg.h>
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+struct LogRecord
+{
+    std::atomic<uint32_t> lap; // slot sequence minus slot index, so zero-init is valid
+    uint32_t timestampMs;
+    uint8_t level;
+    uint8_t argCount;
+    const char *fmt; // nullptr = text is preformatted
+    uint32_t args[LOG_MAX_ARGS];
+    char text[LOG_LINE_MAX];
+};
+
+// Bounded multi-producer queue (Vyukov): each slot's sequence tells producers
+// whether it is free for this lap and the consumer whether it is filled.
+// Everything is zero-initialized, so logging works before logBegin().
+static LogRecord ring[LOG_RING_SIZE];
+static std::atomic<uint32_t> enqueuePosition{0};
+static uint32_t dequeuePosition = 0;
+static std::atomic<uint32_t> dropped{0};
+
+static const char levelLetters[] = {'-', 'E', 'W', 'I', 'D'};
+
+static inline uint32_t slotSequence(const LogRecord *record, std::memory_order order)
+{
+    return record->lap.load(order) + (uint32_t)(record - ring);
+}
+
+static inline void setSlotSequence(LogRecord *record, uint32_t sequence)
+{
+    record->lap.store(sequence - (uint32_t)(record - ring), std::memory_order_release);
+}
+
+static LogRecord *claimSlot(uint32_t &position)
+{
+    position = enqueuePosition.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        LogRecord *record = &ring[position & (LOG_RING_SIZE - 1)];
+        int32_t diff = (int32_t)(slotSequence(record, std::memory_order_acquire) - position);
+        if (diff == 0)
+        {
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                return record;
+        }
+        else if (diff < 0)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        else
+        {
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+static inline void publishSlot(LogRecord *record, uint32_t position)
+{
+    setSlotSequence(record, position + 1);
+}
+
+void logWrite(uint8_t level, const char *fmt, ...)
+{
+    uint32_t position;
+    LogRecord *record = claimSlot(position);
+    if (!record)
+        return;
+
+    record->timestampMs = millis();
+    record->level = level;
+    record->fmt = nullptr;
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(record->text, sizeof(record->text), fmt, args);
+    va_end(args);
+
+    publishSlot(record, position);
+}
+
+void logEnqueueDeferred(uint8_t level, const char *fmt, const uint32_t *args, uint8_t count)
+{
+    uint32_t position;
+    LogRecord *record = claimSlot(position);
+    if (!record)
+        return;
+
+    record->timestampMs = millis();
+    record->level = level;
+    record->fmt = fmt;
+    record->argCount = count;
+    memcpy(record->args, args, sizeof(record->args));
+
+    publishSlot(record, position);
+}
+
+uint32_t logDroppedCount()
+{
+    return dropped.load(std::memory_order_relaxed);
+}
+
+static void writeRecord(LogRecord *record)
+{
+    char line[LOG_LINE_MAX + 16];
+    int prefix = snprintf(line, sizeof(line), "[%7lu] %c ", (unsigned long)record->timestampMs,
+                          levelLetters[record->level < sizeof(levelLetters) ? record->level : 0]);
+
+    if (record->fmt)
+    {
+        const uint32_t *a = record->args;
+        snprintf(line + prefix, sizeof(line) - prefix, record->fmt, a[0], a[1], a[2], a[3], a[4], a[5]);
+    }
+    else
+    {
+        strlcpy(line + prefix, record->text, sizeof(line) - prefix);
+    }
+
+    Serial.println(line);
+}
+
+static void logDrainTask(void *)
+{
+    uint32_t reportedDrops = 0;
+
+    for (;;)
+    {
+        for (;;)
+        {
+            LogRecord *record = &ring[dequeuePosition & (LOG_RING_SIZE - 1)];
+            if (slotSequence(record, std::memory_order_acquire) != dequeuePosition + 1)
+                break;
+
+            writeRecord(record);
+            setSlotSequence(record, dequeuePosition + LOG_RING_SIZE);
+            dequeuePosition++;
+        }
+
+        uint32_t drops = dropped.load(std::memory_order_relaxed);
+        if (drops != reportedDrops)
+        {
+            Serial.printf("[log] %lu records dropped\n", (unsigned long)(drops - reportedDrops));
+            reportedDrops = drops;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(20));
+    }
+}
+
+void logBegin()
+{
+    xTaskCreatePinnedToCore(logDrainTask, "log", 3072, nullptr, LOG_TASK_PRIORITY, nullptr, 0);
+}
@@ -1,5 +1,21 @@
 #include <config.h>
 #include <color_tools.h>
+#include <shadow_panel.h>
+#include <panel_color.h>
+#include <frame_stream.h>
+#include <marquee.h>
+#include <alloc_guard.h>
+#include <string_hash.h>
+#include <spotify_stats.h>
+#include <net_guard.h>
+#include <power_profile.h>
+#include <memory_report.h>
+#include <fleet.h>
+#include <time_service.h>
+#include <backdrop.h>
+#include <cover_ingest.h>
+#include <cover_palette.h>
+#include <log.h>
 #include <Arduino.h>
 #include <ESP32-HUB75-MatrixPanel-I2S-DMA.h>
 #include <WiFi.h>
@@ -14,228 +30,271 @@
 #include <Fonts/FreeSansBold12pt7b.h>
 #include <Fonts/FreeSansBold18pt7b.h>
 #include <map>
+#include <vector>
 #include <algorithm>
 #include <cmath>
 
 #define countof(x) (sizeof(x) / sizeof(x[0]))
 
+// Album art in the forms the render needs. There are two sets, so the net
+// task can decode the next cover while the render task draws the current one
+struct CoverBuffers
+{
+    uint8_t *rgb;    // decoded album art, packed RGB888, PANEL_PIXELS in PSRAM
+    uint8_t *panel;  // rgb after gamma and dithering, as driver bytes
+    uint16_t *frame; // rgb as RGB565 for the frame mirror
+};
+
+// What the render task shows. The net task publishes it under nowPlayingLock,
+// which the render task holds while it draws a frame; the net task never
+// holds it across network I/O
+struct NowPlaying
+{
+    uint32_t sequence; // bumped on every publish
+    bool playing;
+    uint32_t trackHash;
+    uint16_t primaryColor;
+    uint16_t secondaryColor;
+    CoverBuffers *cover; // nullptr = no usable cover, clock-only scene
+    char text[MARQUEE_MAX_BYTES];
+};
+
 // variables
-MatrixPanel_I2S_DMA *display;
-String currentAlbumArtUrl = "";
-String previousAlbumArtUrl = " ";
+ShadowPanel *display;
+const char *weekDays[] = {"SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT"};
+CoverBuffers covers[2];
+NowPlaying nowPlaying = {};
+SemaphoreHandle_t nowPlayingLock = nullptr;
+TaskHandle_t renderTask = nullptr;
+BackdropRegion clockBackdrop = {}; // where the centered clock lands over the cover
+
+// net task state, published through nowPlaying
+uint32_t currentAlbumArtHash = 0; // FNV-1a of the cover URL, 0 = none
+uint32_t currentTrackHash = 0;    // FNV-1a of the track id, 0 = none
 uint16_t leastPredominantColor = 0;
 uint16_t mostPredominantColor = 0;
 bool isSpotifyPlaying = false;
 bool spotifyInitialized = false;
 bool spotifyAuthenticated = false;
-const char *weekDays[] = {"SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT"};
+CoverBuffers *currentCover = nullptr; // last good cover, nullptr = none
+uint8_t *decodeRgb = nullptr;         // where drawMCU stores pixels
+char trackText[MARQUEE_MAX_BYTES];
+char coverUrl[FLEET_URL_MAX]; // shared with fleet followers
 
 // objects
 Spotify sp(CLIENT_ID, CLIENT_SECRET, REFRESH_TOKEN);
-JPEGDEC jpeg;
 Adafruit_NeoPixel pixels(1, NEOPIXEL_PIN, NEO_GRB + NEO_KHZ800);
+Marquee marquee;
 
-// Custom allocator for PSRAM
-template <typename T>
-struct PSRAMAllocator
-{
-    typedef T value_type;
-
-    PSRAMAllocator() = default;
-    template <class U>
-    constexpr PSRAMAllocator(const PSRAMAllocator<U> &) noexcept {}
-
-    T *allocate(std::size_t n)
-    {
-        if (n > std::size_t(-1) / sizeof(T))
-            throw std::bad_alloc();
-        if (auto p = static_cast<T *>(heap_caps_malloc(n * sizeof(T), MALLOC_CAP_SPIRAM)))
-            return p;
-        throw std::bad_alloc();
-    }
-
-    void deallocate(T *p, std::size_t) noexcept { heap_caps_free(p); }
-};
-
-template <class T, class U>
-bool operator==(const PSRAMAllocator<T> &, const PSRAMAllocator<U> &) { return true; }
-template <class T, class U>
-bool operator!=(const PSRAMAllocator<T> &, const PSRAMAllocator<U> &) { return false; }
-
-std::map<uint16_t, int, std::less<uint16_t>, PSRAMAllocator<std::pair<const uint16_t, int>>> colorCounts;
-
-uint16_t extractMostVibrantColor(const std::map<uint16_t, int, std::less<uint16_t>, PSRAMAllocator<std::pair<const uint16_t, int>>> &colorCounts)
-{
-    uint16_t mostVibrantColor = 0;
-    float maxVibrancy = -1.0f;
-
-    for (std::map<uint16_t, int, std::less<uint16_t>, PSRAMAllocator<std::pair<const uint16_t, int>>>::const_iterator it = colorCounts.begin(); it != colorCounts.end(); ++it)
-    {
-        uint16_t color = it->first;
-        float vibrancy = calculateVibrancy(color);
-
-        if (vibrancy > maxVibrancy)
-        {
-            maxVibrancy = vibrancy;
-            mostVibrantColor = color;
-        }
-    }
-
-    return mostVibrantColor;
-}
+ColorCounts colorCounts;
 
-int downloadImage(String imageUrl)
+// Downloads the cover into /cover.jpg. The body is streamed through a temp
+// file with a size cap and the NetOperation deadline, so a stalled or
+// oversized response fails instead of wedging the loop or leaving half a file.
+int downloadImage(const char *imageUrl)
 {
-    Serial.println("Downloading image... " + imageUrl);
+    LOG_I("Downloading image... %s", imageUrl);
+    NetOperation op(NET_STAGE_COVER_REQUEST);
     HTTPClient http;
+    http.setConnectTimeout(NET_CONNECT_TIMEOUT_MS);
+    http.setTimeout(NET_READ_TIMEOUT_MS);
+    http.useHTTP10(true); // no chunked encoding, so the raw stream is the body
 
-    File f = LittleFS.open("/cover.jpg", "w");
-
-    if (!f)
+    if (!http.begin(imageUrl))
     {
-        Serial.println("Error opening file");
+        LOG_E("[HTTP] begin failed");
         return -1;
     }
 
-    http.begin(imageUrl);
-
     int httpCode = http.GET();
 
     if (httpCode != HTTP_CODE_OK)
     {
-        Serial.println("[HTTP] GET... failed, error: " + http.errorToString(httpCode) + " : " + String(httpCode));
-        Serial.println("Response: " + http.getString());
-        f.close();
+        LOG_W("[HTTP] GET... failed, error: %s : %d", http.errorToString(httpCode).c_str(), httpCode);
         http.end();
         return -1;
     }
 
-    int fileCode = http.writeToStream(&f);
-
-    if (fileCode < 0)
+    int size = http.getSize(); // -1 when the server sends no length
+    if (size > NET_MAX_COVER_BYTES)
     {
-        Serial.println(F("Error writing to file"));
-        f.close();
+        LOG_W("Cover too large: %d bytes", size);
         http.end();
         return -1;
     }
 
-    Serial.println("File Downloaded");
+    File f = LittleFS.open("/cover.tmp", "w");
 
-    f.close();
-    http.end();
-    return 0;
-}
+    if (!f)
+    {
+        LOG_E("Error opening file");
+        http.end();
+        return -1;
+    }
 
-int drawMCU(JPEGDRAW *pDraw)
-{
+    op.stage(NET_STAGE_COVER_BODY);
+    WiFiClient *stream = http.getStreamPtr();
+    uint8_t chunk[512];
+    int total = 0;
+    bool failed = false;
 
-    uint16_t *pPixel = (uint16_t *)pDraw->pPixels;
-    for (int y = 0; y < pDraw->iHeight; y++)
+    while (size < 0 || total < size)
     {
-        for (int x = 0; x < pDraw->iWidth; x++)
+        if (op.expired())
         {
-            display->drawPixel(x + pDraw->x, y + pDraw->y, pPixel[y * pDraw->iWidth + x]);
+            LOG_W("Cover download cancelled after %" PRIu32 " ms, %d bytes", op.elapsedMs(), total);
+            failed = true;
+            break;
+        }
 
-            // Count the occurrences of each color
-            colorCounts[pPixel[y * pDraw->iWidth + x]]++;
+        size_t available = stream->available();
+        if (available == 0)
+        {
+            if (!stream->connected())
+                break;
+            delay(1);
+            continue;
         }
-    }
 
-    return 1; // Continue decoding
-}
+        int n = stream->read(chunk, std::min(available, sizeof(chunk)));
+        if (n <= 0)
+            continue;
 
-void drawJPEG(const char *filename, int xpos, int ypos)
-{
+        if (total + n > NET_MAX_COVER_BYTES)
+        {
+            LOG_W("Cover exceeds %d bytes", NET_MAX_COVER_BYTES);
+            failed = true;
+            break;
+        }
 
-    colorCounts.clear();
+        if (f.write(chunk, n) != (size_t)n)
+        {
+            LOG_E("Error writing to file");
+            failed = true;
+            break;
+        }
 
-    File file = LittleFS.open(filename, "r");
-    if (!file)
-    {
-        Serial.println("Failed to open file for reading");
-        return;
+        total += n;
+        op.progress();
     }
 
-    int fileSize = file.size();
-    if (fileSize <= 0)
-    {
-        Serial.println("Empty image file");
-        file.close();
-        return;
-    }
+    f.close();
+    http.end();
 
-    uint8_t *buffer = (uint8_t *)malloc((size_t)fileSize);
-    if (!buffer)
+    if (!failed && size >= 0 && total != size)
     {
-        Serial.println("Not enough memory to load image");
-        file.close();
-        return;
+        LOG_W("Cover truncated: %d of %d bytes", total, size);
+        failed = true;
     }
 
-    size_t readBytes = file.read(buffer, fileSize);
-    if ((int)readBytes != fileSize)
+    if (failed || total == 0 || !LittleFS.rename("/cover.tmp", "/cover.jpg"))
     {
-        Serial.println("Warning: read fewer bytes than file size");
+        LittleFS.remove("/cover.tmp");
+        return -1;
     }
-    file.close();
 
-    if (jpeg.openRAM(buffer, fileSize, drawMCU))
-    {
-        jpeg.decode(xpos, ypos, 0); // 0 = full size
-        jpeg.close();
-    }
+    LOG_I("File Downloaded");
+    return 0;
+}
 
-    free(buffer);
+int drawMCU(JPEGDRAW *pDraw)
+{
+    coverPaletteStoreBlock(decodeRgb, PANEL_WIDTH, PANEL_HEIGHT, (const uint32_t *)pDraw->pPixels, pDraw->x, pDraw->y,
+                           pDraw->iWidth, pDraw->iHeight, colorCounts);
+    return 1; // Continue decoding
+}
 
-    Serial.println("Color counts:" + String(colorCounts.size()));
+// The cover buffers the render task is not showing. Only the net task
+// publishes, so it can read nowPlaying.cover without the lock
+CoverBuffers *spareCover()
+{
+    return nowPlaying.cover == &covers[0] ? &covers[1] : &covers[0];
+}
 
-    // Find the least and most predominant colors
-    std::pair<decltype(colorCounts)::iterator, decltype(colorCounts)::iterator> minmax;
+// Derives the mirror and panel copies from cover->rgb
+void prepareCoverPixels(CoverBuffers *cover)
+{
+    unsigned long start = micros();
+    rgb888ToRgb565Buffer(cover->rgb, cover->frame, PANEL_PIXELS);
+#if !DITHER_TEMPORAL
+    static_assert(PANEL_WIDTH <= DITHER_MAX_WIDTH, "DITHER_MAX_WIDTH must cover the panel");
+    ditherErrorDiffusion(cover->rgb, cover->panel, PANEL_WIDTH, PANEL_HEIGHT);
+#endif
+    LOG_I_DEFER("Cover dithered to %u bits in %" PRIu32 " us", PANEL_COLOR_DEPTH_BITS, micros() - start);
+}
 
-    minmax = std::minmax_element(
-        colorCounts.begin(), colorCounts.end(),
-        [](const decltype(colorCounts)::value_type &a, const decltype(colorCounts)::value_type &b)
-        {
-            return a.second < b.second;
-        });
+// Decodes the cover at full RGB888 precision into the spare buffers, prepares
+// the dithered panel copy and extracts the clock colors. Runs once per track
+// change on the net task; drawCover() blits the cached pixels every frame. A
+// cover that fails validation or decoding leaves currentCover empty, and the
+// render task shows the clock-only scene.
+void decodeCover(const char *filename)
+{
+    CoverBuffers *cover = spareCover();
+    colorCounts.clear();
+    currentCover = nullptr;
 
-    mostPredominantColor = minmax.second->first;
-    leastPredominantColor = minmax.first->first;
+    decodeRgb = cover->rgb;
+    memset(cover->rgb, 0, PANEL_PIXELS * 3);
+    CoverIngestResult result = coverIngestDecode(filename, drawMCU);
+    CoverPalette palette;
+    if (result != COVER_OK || !coverPaletteExtract(colorCounts, palette))
+    {
+        LOG_W("Cover rejected: %s", coverIngestResultName(result));
+        colorCounts.clear();
+        pixels.setPixelColor(0, pixels.Color(0, 0, 0));
+        pixels.show();
+        return;
+    }
+
+#if CLOCK_BACKDROP
+    // Colors were already counted from the sharp art in drawMCU
+    LOG_I_DEFER("Clock backdrop applied in %" PRIu32 " us", backdropApply(cover->rgb, clockBackdrop));
+#endif
+    prepareCoverPixels(cover);
+    currentCover = cover;
+
+    LOG_I_DEFER("Color counts:%u", colorCounts.size());
+
+    mostPredominantColor = palette.primary;
+    leastPredominantColor = palette.secondary;
 
     uint8_t r, g, b;
     uint8_t lr, lg, lb;
 
-    display->color565to888(mostPredominantColor, r, g, b);
-    display->color565to888(leastPredominantColor, lr, lg, lb);
+    display->color565to888(palette.mostCommon, r, g, b);
+    display->color565to888(palette.leastCommon, lr, lg, lb);
 
     pixels.setPixelColor(0, pixels.Color(r, g, b));
     pixels.show();
 
-    Serial.printf("Album colors -> primary RGB: (%u, %u, %u) secondary RGB: (%u, %u, %u)\n", r, g, b, lr, lg, lb);
+    LOG_I_DEFER("Album colors -> primary RGB: (%u, %u, %u) secondary RGB: (%u, %u, %u)", r, g, b, lr, lg, lb);
 
-    // if mostPredominantColor is similar to leastPredominantColor the second least predominat font
-
-    if (areColorsSimilar(mostPredominantColor, leastPredominantColor, COLOR_SIMILARITY_THRESHOLD))
-    {
-        Serial.println("Most predominant color is similar to least predominant color");
+    // Log final colors used for clock after adjustments
+    display->color565to888(mostPredominantColor, r, g, b);
+    display->color565to888(leastPredominantColor, lr, lg, lb);
+    LOG_I_DEFER("Clock colors -> primary RGB: (%u, %u, %u) secondary RGB: (%u, %u, %u)", r, g, b, lr, lg, lb);
+}
 
-        uint16_t vibrantColor = extractMostVibrantColor(colorCounts);
+void drawCover(CoverBuffers *cover)
+{
+    if (!cover)
+        return;
 
-        leastPredominantColor = vibrantColor;
+#if DITHER_TEMPORAL
+    static uint32_t ditherFrame = 0;
+    ditherOrdered(cover->rgb, cover->panel, PANEL_WIDTH, PANEL_HEIGHT, ditherFrame++);
+#endif
 
-        if (areColorsSimilar(mostPredominantColor, leastPredominantColor, COLOR_SIMILARITY_THRESHOLD))
+    for (int y = 0; y < PANEL_HEIGHT; y++)
+    {
+        for (int x = 0; x < PANEL_WIDTH; x++)
         {
-            Serial.println("Invert color");
-
-            leastPredominantColor = invertColor(mostPredominantColor);
+            int i = y * PANEL_WIDTH + x;
+            const uint8_t *p = cover->panel + i * 3;
+            display->drawPanelPixel(x, y, p[0], p[1], p[2], cover->frame[i]);
         }
     }
-
-    // Log final colors used for clock after adjustments
-    display->color565to888(mostPredominantColor, r, g, b);
-    display->color565to888(leastPredominantColor, lr, lg, lb);
-    Serial.printf("Clock colors -> primary RGB: (%u, %u, %u) secondary RGB: (%u, %u, %u)\n", r, g, b, lr, lg, lb);
 }
 
 void drawWeekDay(int day, int hour)
@@ -364,7 +423,24 @@ void drawMonthDay(int day, int hour)
     }
 }
 
-void drawClock(String clockText, uint16_t bodyColor, uint16_t counterColor, bool center)
+// "HH:MM", or "--:--" while the time is unknown
+void formatClock(char *text, size_t size, const struct tm *timeinfo)
+{
+    if (!timeinfo)
+    {
+        strlcpy(text, "--:--", size);
+        LOG_EVERY_MS(10000, LOG_W("Time not set yet"));
+        return;
+    }
+
+    snprintf_P(text,
+               size,
+               PSTR("%02u:%02u"),
+               timeinfo->tm_hour,
+               timeinfo->tm_min);
+}
+
+void drawClock(const char *clockText, uint16_t bodyColor, uint16_t counterColor, bool center)
 {
     display->setFont(&FreeSans12pt7b);
 
@@ -385,24 +461,36 @@ void drawClock(String clockText, uint16_t bodyColor, uint16_t counterColor, bool
 
             display->setTextColor(counterColor);
 
-            display->printf(clockText.c_str());
+            display->print(clockText);
         }
     }
 
     display->setCursor(xOffset, yOffset);
     display->setTextColor(bodyColor);
-    display->printf(clockText.c_str());
+    display->print(clockText);
+}
+
+// Bounds of the widest clock drawClock() can print centered, outline included
+BackdropRegion measureClockRegion()
+{
+    int16_t x1, y1;
+    uint16_t w, h;
+    display->setFont(&FreeSans12pt7b);
+    display->setTextSize(1);
+    display->getTextBounds("00:00", 3, 40, &x1, &y1, &w, &h);
+    return {(int16_t)(x1 - 1), (int16_t)(y1 - 1), (int16_t)(w + 2), (int16_t)(h + 2)};
 }
 
 bool hasInternetConnectivity()
 {
+    NetOperation op(NET_STAGE_CONNECTIVITY);
     HTTPClient http;
-    http.setConnectTimeout(3000);
-    http.setTimeout(3000);
+    http.setConnectTimeout(NET_CONNECT_TIMEOUT_MS);
+    http.setTimeout(NET_READ_TIMEOUT_MS);
 
     if (!http.begin("http://clients3.google.com/generate_204"))
     {
-        Serial.println(F("Connectivity check begin failed"));
+        LOG_E("Connectivity check begin failed");
         return false;
     }
 
@@ -411,11 +499,11 @@ bool hasInternetConnectivity()
     bool ok = code == 204;
     if (ok)
     {
-        Serial.println(F("Internet reachable"));
+        LOG_I("Internet reachable");
     }
     else
     {
-        Serial.println("No internet, code: " + String(code));
+        LOG_W("No internet, code: %d", code);
     }
     return ok;
 }
@@ -427,28 +515,34 @@ void ensureSpotifyReady()
 
     if (WiFi.status() != WL_CONNECTED)
     {
-        Serial.println(F("WiFi lost, cannot init Spotify"));
+        LOG_W("WiFi lost, cannot init Spotify");
         spotifyInitialized = false;
         return;
     }
 
+#ifdef SPOTIFY_MOCK_HOST
+    // Requests go to tools/mock_spotify.py, which needs no OAuth
+    spotifyAuthenticated = true;
+    LOG_I("Using mock Spotify at %s:%d", SPOTIFY_MOCK_HOST, SPOTIFY_MOCK_PORT);
+    return;
+#endif
+
     if (!hasInternetConnectivity())
     {
-        Serial.println(F("No internet, deferring Spotify auth"));
+        LOG_W("No internet, deferring Spotify auth");
         return;
     }
 
     if (!spotifyInitialized)
     {
-        Serial.print(F("Spotify begin: "));
         sp.begin();
         spotifyInitialized = true;
-        Serial.println(F("started"));
+        LOG_I("Spotify begin: started");
     }
 
     if (!sp.is_auth())
     {
-        Serial.print(F("Authenticating Spotify (timeout 10s): "));
+        LOG_I("Authenticating Spotify (timeout 10s)");
         unsigned long start = millis();
         while (!sp.is_auth() && millis() - start < 10000)
         {
@@ -458,327 +552,642 @@ void ensureSpotifyReady()
         if (sp.is_auth())
         {
             spotifyAuthenticated = true;
-            Serial.printf("Authenticated! Refresh token: %s\n", sp.get_user_tokens().refresh_token);
+            LOG_I("Authenticated! Refresh token: %s", sp.get_user_tokens().refresh_token);
         }
         else
         {
-            Serial.println(F("Auth not completed, will retry later"));
+            LOG_W("Auth not completed, will retry later");
         }
     }
     else
     {
         spotifyAuthenticated = true;
-        Serial.println(F("Spotify already authenticated"));
+        LOG_I("Spotify already authenticated");
     }
 }
 
-void setup()
+// Builds "Title - Artist, Artist" from the currently playing reply
+void updateTrackText(JsonVariant item)
 {
-    // Initialize USBSerial port
-    Serial.begin(115200);
-    Serial.println("\nStart!");
+    size_t length = strlcpy(trackText, item["name"] | "", sizeof(trackText));
 
-    // Start led matrix
-    Serial.println(F("Led Matrix begin"));
-    HUB75_I2S_CFG mxconfig(
-        64,
-        64,
-        1,
-        MATRIX_PINS);
+    JsonArray artists = item["artists"].as<JsonArray>();
+    const char *separator = " - ";
+    for (JsonVariant artist : artists)
+    {
+        if (length >= sizeof(trackText))
+            break;
+        length += snprintf(trackText + length, sizeof(trackText) - length, "%s%s", separator, artist["name"] | "");
+        separator = ", ";
+    }
+}
 
-    mxconfig.driver = HUB75_I2S_CFG::ICN2038S;
-    mxconfig.clkphase = false;
-    mxconfig.latch_blanking = 4;
-    mxconfig.i2sspeed = HUB75_I2S_CFG::HZ_10M;
-    mxconfig.double_buff = true;
+// Returns false when Spotify did not answer (error, rate limit, timeout);
+// the state from the last good poll is kept
+bool pollSpotify()
+{
+    // Get the current uptime
+    LOG_EVERY_MS(60000, LOG_I_DEFER("Uptime in minutes: %" PRIu32, millis() / 60000));
 
-    // Display Setup
-    display = new MatrixPanel_I2S_DMA(mxconfig);
-    display->begin();
-    display->setBrightness8(DISPLAY_BRIGHTNESS);
-    display->clearScreen();
-    display->flipDMABuffer();
+    LOG_D("Checking Spotify state");
 
-    // Initialize LittleFS
-    Serial.print(F("LittleFS begin: "));
-    if (!LittleFS.begin(true))
+    unsigned long pollStart = millis();
+    response currentState;
     {
-        Serial.println(F("failed"));
+        NetOperation op(NET_STAGE_SPOTIFY_POLL);
+        currentState = spotifyStatsCurrentlyPlaying(sp);
     }
-    else
+
+    /*
+    State
+      200 Information about playback
+      204 Playback not available or active
+      401 Bad or expired token. This can happen if the user revoked a token or the access token has expired. You should re-authenticate the user.
+      403 Bad OAuth request (wrong consumer key, bad nonce, expired timestamp...). Unfortunately, re-authenticating the user won't help here.
+      429 The app has exceeded its rate limits.
+    */
+
+    if (currentState.status_code != 200)
     {
-        Serial.println(F("ok"));
-    }
+        LOG_EVERY_MS(10000, LOG_W_DEFER("Error, code: %d", currentState.status_code));
 
-    // Initialize Wifi
-    Serial.print(F("WiFi begin: "));
+        if (currentState.status_code == 201)
+        {
+            LOG_I("Spotify on inactive");
 
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(WIFI_SSID, WIFI_PASS);
-    while (WiFi.status() != WL_CONNECTED)
+            isSpotifyPlaying = false;
+        }
+
+        if(currentState.status_code == 204)
+        {
+            LOG_EVERY_MS(60000, LOG_I("No content, playback not active"));
+
+            isSpotifyPlaying = false;
+        }
+
+        if (currentState.status_code == 401)
+        {
+            LOG_W("The access token expired, retrying on the next poll");
+
+            NetOperation op(NET_STAGE_TOKEN_REFRESH);
+            spotifyStatsRefreshToken(sp);
+        }
+
+        if (currentState.status_code == 403)
+        {
+            LOG_E("Bad OAuth request");
+        }
+
+        if (currentState.status_code == 429)
+        {
+            LOG_W("The app has exceeded its rate limits.");
+        }
+
+        if (strcmp(currentState.reply["message"] | "", "Timeout receiving headers") == 0)
+        {
+            // Retried on the next poll rather than blocking this frame again
+            LOG_W("Timeout receiving headers");
+        }
+    }
+
+    if (currentState.status_code < 200 || currentState.status_code >= 300)
     {
-        delay(500);
-        Serial.print(".");
+        return false;
     }
 
-    if (WiFi.status() != WL_CONNECTED)
+    // check if is play is null
+    if (!currentState.reply["is_playing"].isNull())
     {
-        Serial.println(F("\nWiFi failed! Restarting..."));
-        // ESP.restart();
+        isSpotifyPlaying = currentState.reply["is_playing"].as<bool>();
     }
-    else
+
+    if (isSpotifyPlaying)
     {
+        LOG_D("Spotify is playing");
 
-        Serial.println((String) "RSSI : " + WiFi.RSSI() + " dB");
-        Serial.println("\nIP:" + WiFi.localIP().toString());
+        JsonVariant item = currentState.reply["item"];
+        const char *albumArtUrl = nullptr;
+        bool coverChanged = false;
+        bool trackChanged = false;
 
-        // Set primary DNS server
-        IPAddress primaryDNS(8, 8, 8, 8); // Google's DNS server
+        // Same track and cover as last poll: nothing below may touch the heap
+        {
+            AllocGuard guard("poll compare");
 
-        // Set secondary DNS server (optional)
-        IPAddress secondaryDNS(8, 8, 4, 4); // Google's secondary DNS server
+            albumArtUrl = item["album"]["images"][2]["url"].as<const char *>();
+            if (albumArtUrl)
+            {
+                coverChanged = hashUpdate(currentAlbumArtHash, albumArtUrl);
+            }
 
-        // Apply DNS settings
-        if (WiFi.config(WiFi.localIP(), WiFi.gatewayIP(), WiFi.subnetMask(), primaryDNS, secondaryDNS))
-        {
-            Serial.println("DNS Server configuration successful");
+            trackChanged = hashUpdate(currentTrackHash, item["id"] | "");
         }
-        else
+
+        if (coverChanged || trackChanged)
         {
-            Serial.println("DNS Server configuration failed");
+            spotifyStatsChangeBegin(pollStart, millis() - pollStart);
         }
 
-        // Print the DNS server to verify
-        Serial.print("DNS Server: ");
-        Serial.println(WiFi.dnsIP());
-    }
+        if (coverChanged)
+        {
+            unsigned long downloadStart = millis();
+            int downloadResult = downloadImage(albumArtUrl);
 
-    // Initialize mDNS
-    Serial.print(F("mDNS begin: "));
-    if (!MDNS.begin(PROJECTNAME))
-    {
-        Serial.println(F("failed"));
-        // ESP.restart();
+            LOG_I_DEFER("Download result: %d", downloadResult);
+
+            unsigned long decodeStart = millis();
+            if (downloadResult == 0)
+            {
+                strlcpy(coverUrl, albumArtUrl, sizeof(coverUrl));
+                decodeCover("/cover.jpg");
+                if (currentCover)
+                {
+                    fleetPublishCover(currentAlbumArtHash, currentCover->rgb);
+                }
+            }
+            else
+            {
+                currentAlbumArtHash = 0; // try again on the next poll
+            }
+            spotifyStatsChangeStages(decodeStart - downloadStart, millis() - decodeStart);
+        }
+
+        if (trackChanged)
+        {
+            updateTrackText(item);
+        }
     }
     else
     {
-        // Set the hostname to "$PROJECTNAME.local"
-        Serial.println(F("ok"));
+        LOG_D("Spotify is not playing, drawing clock");
+
+        pixels.setPixelColor(0, pixels.Color(0, 0, 0));
+        pixels.show();
+
+        currentAlbumArtHash = 0;
+        currentTrackHash = 0;
     }
+    return true;
+}
 
-    // Initialize NTP
-    setenv("TZ", TZ_STRING, 1);                                                              // Set timezone
-    configTime(NTP_GMT_OFFSET_SECONDS, NTP_DAYLIGHT_OFFSET_SECONDS, ntpServer1, ntpServer2); // Init and get the time
+// Leader side of fleet mode: share what the last poll found
+void publishFleetState()
+{
+    FleetNowPlaying state = {};
+    state.playing = isSpotifyPlaying;
+    state.trackHash = currentTrackHash;
+    state.coverHash = currentAlbumArtHash;
+    state.primaryColor = mostPredominantColor;
+    state.secondaryColor = leastPredominantColor;
+    strlcpy(state.coverUrl, coverUrl, sizeof(state.coverUrl));
+    strlcpy(state.text, trackText, sizeof(state.text));
+    fleetPublish(state);
+}
 
-    struct tm timeinfo;
+// Follower side of fleet mode: applies the leader's state instead of polling
+void followFleet()
+{
+    FleetNowPlaying state;
+    if (!fleetLatest(state))
+        return;
 
-    if (!getLocalTime(&timeinfo))
+    isSpotifyPlaying = state.playing;
+    if (!isSpotifyPlaying)
     {
-        Serial.println(F("Failed to obtain time"));
+        if (currentTrackHash || currentAlbumArtHash)
+        {
+            pixels.setPixelColor(0, pixels.Color(0, 0, 0));
+            pixels.show();
+            currentAlbumArtHash = 0;
+            currentTrackHash = 0;
+        }
         return;
     }
-    Serial.println(&timeinfo, "%A, %B %d %Y %H:%M:%S");
 
-    // Initialize Spotify (lazy, internet-checked)
-    ensureSpotifyReady(); // Will defer if no internet
-
-    pinMode(PIN_LED, OUTPUT);
-    pinMode(PIN_LIGHT_SENSOR, INPUT);
+    if (state.trackHash != currentTrackHash)
+    {
+        currentTrackHash = state.trackHash;
+        strlcpy(trackText, state.text, sizeof(trackText));
+    }
 
-    if (!getLocalTime(&timeinfo))
+    if (state.coverHash != currentAlbumArtHash)
     {
-        Serial.println(F("Failed to obtain time"));
+        // Wait for the shared pixels, but fetch the image ourselves if they do not arrive
+        static uint32_t waitingFor = 0;
+        static unsigned long waitStart = 0;
+        if (waitingFor != state.coverHash)
+        {
+            waitingFor = state.coverHash;
+            waitStart = millis();
+        }
+
+        bool loaded = false;
+        CoverBuffers *cover = spareCover();
+        if (FLEET_SHARE_COVER && fleetTakeCover(state.coverHash, cover->rgb))
+        {
+            prepareCoverPixels(cover);
+            currentCover = cover;
+            loaded = true;
+        }
+        else if (!FLEET_SHARE_COVER || millis() - waitStart > FLEET_COVER_RESEND_MS + FLEET_HEARTBEAT_MS)
+        {
+            if (downloadImage(state.coverUrl) == 0)
+            {
+                decodeCover("/cover.jpg");
+                loaded = currentCover != nullptr;
+            }
+            waitStart = millis();
+        }
+
+        if (loaded)
+        {
+            currentAlbumArtHash = state.coverHash;
+        }
     }
 
-    char datestring[6];
-    snprintf_P(datestring,
-               countof(datestring),
-               PSTR("%02u:%02u"),
-               timeinfo.tm_hour,
-               timeinfo.tm_min);
+    if (state.primaryColor != mostPredominantColor || state.secondaryColor != leastPredominantColor)
+    {
+        mostPredominantColor = state.primaryColor;
+        leastPredominantColor = state.secondaryColor;
 
-    drawMonthDay(timeinfo.tm_mday, timeinfo.tm_hour);
-    drawWeekDay(timeinfo.tm_wday, timeinfo.tm_hour);
-    drawClock(datestring, getClockDigitColor(timeinfo.tm_hour, timeinfo.tm_min), 0, false);
+        uint8_t r, g, b;
+        display->color565to888(mostPredominantColor, r, g, b);
+        pixels.setPixelColor(0, pixels.Color(r, g, b));
+        pixels.show();
+    }
+}
 
-    display->flipDMABuffer();
+// Hands the net task's state to the render task and wakes it. Does nothing
+// when the state is unchanged, so a steady poll costs the render task nothing
+void publishNowPlaying()
+{
+    static NowPlaying next;
+    next.playing = isSpotifyPlaying;
+    next.trackHash = currentTrackHash;
+    next.primaryColor = mostPredominantColor;
+    next.secondaryColor = leastPredominantColor;
+    next.cover = currentCover;
+    strlcpy(next.text, trackText, sizeof(next.text));
+
+    // Only this task writes nowPlaying, so reading it here needs no lock
+    if (next.playing == nowPlaying.playing && next.trackHash == nowPlaying.trackHash &&
+        next.primaryColor == nowPlaying.primaryColor && next.secondaryColor == nowPlaying.secondaryColor &&
+        next.cover == nowPlaying.cover && strcmp(next.text, nowPlaying.text) == 0)
+        return;
 
-    pixels.begin(); // Initialize NeoPixel strip
-    pixels.setBrightness(NEOPIXEL_BRIGHTNESS);
+    xSemaphoreTake(nowPlayingLock, portMAX_DELAY);
+    next.sequence = nowPlaying.sequence + 1;
+    nowPlaying = next;
+    xSemaphoreGive(nowPlayingLock);
+
+    spotifyStatsChangePublished(next.sequence);
+    xTaskNotifyGive(renderTask);
 }
 
-void loop()
+// Render side of a publish: the marquee is rasterized here, on the task that
+// draws it. Called with nowPlayingLock held
+void applyNowPlaying()
 {
-    // Reconnect if wifi is down
-    if (WiFi.status() != WL_CONNECTED)
+    static uint32_t appliedSequence = 0;
+    static uint32_t appliedTrackHash = 0;
+    if (nowPlaying.sequence == appliedSequence)
+        return;
+    appliedSequence = nowPlaying.sequence;
+
+    if (!nowPlaying.playing)
+    {
+        marquee.clear();
+        appliedTrackHash = 0;
+        return;
+    }
+
+    if (nowPlaying.trackHash != appliedTrackHash)
     {
-        Serial.println("Reconnecting to WiFi...");
-        WiFi.disconnect();
-        WiFi.reconnect();
+        appliedTrackHash = nowPlaying.trackHash;
+        marquee.setText(nowPlaying.text);
+        LOG_I_DEFER("Marquee rasterized in %" PRIu32 " us", marquee.lastRenderMicros());
     }
+}
 
-    ensureSpotifyReady();
+void renderNowPlaying(const NowPlaying &state)
+{
+    unsigned long start = micros();
 
-    if (!spotifyAuthenticated)
-    {
-        Serial.println(F("Spotify not ready, showing clock only"));
+    display->clearScreen();
 
-        display->clearScreen();
+    drawCover(state.cover);
 
-        struct tm timeinfo;
-        if (!getLocalTime(&timeinfo))
+    struct tm timeinfo;
+    char datestring[6];
+    formatClock(datestring, sizeof(datestring), timeLocal(timeinfo) ? &timeinfo : nullptr);
+
+    drawClock(datestring, state.primaryColor, state.secondaryColor, true);
+
+    marquee.draw(display, MARQUEE_Y, state.primaryColor, state.secondaryColor, millis());
+
+    display->flipDMABuffer();
+    spotifyStatsFramePresented(state.sequence);
+
+    // Report the average frame cost every few seconds
+    static unsigned long frameMicros = 0;
+    static unsigned long frameCount = 0;
+    static unsigned long lastReport = 0;
+    frameMicros += micros() - start;
+    frameCount++;
+    if (millis() - lastReport >= 10000)
+    {
+        LOG_I_DEFER("Frame cost: %" PRIu32 " us avg over %" PRIu32 " frames, marquee draw %" PRIu32 " us",
+                      frameMicros / frameCount, frameCount, marquee.lastDrawMicros());
+        if (display->isStaged())
         {
-            Serial.println(F("Failed to obtain time"));
+            LOG_I_DEFER("Single-buffer commit: %" PRIu32 " pixels in %" PRIu32 " us",
+                        display->lastCommitPixels(), display->lastCommitMicros());
         }
+        frameMicros = 0;
+        frameCount = 0;
+        lastReport = millis();
+    }
+}
 
-        char datestring[6];
-        snprintf_P(datestring,
-                   countof(datestring),
-                   PSTR("%02u:%02u"),
-                   timeinfo.tm_hour,
-                   timeinfo.tm_min);
+void renderIdleClock()
+{
+    display->clearScreen();
 
-        drawMonthDay(timeinfo.tm_mday, timeinfo.tm_hour);
-        drawWeekDay(timeinfo.tm_wday, timeinfo.tm_hour);
-        drawClock(datestring, getClockDigitColor(timeinfo.tm_hour, timeinfo.tm_min), 0, timeinfo.tm_hour <= NIGHT_END_HOUR || timeinfo.tm_hour >= NIGHT_START_HOUR);
+    struct tm timeinfo;
+    char datestring[6];
+
+    if (!timeLocal(timeinfo))
+    {
+        // Nothing to show but a placeholder until SNTP answers
+        formatClock(datestring, sizeof(datestring), nullptr);
+        drawClock(datestring, getClockDigitColor(12, 0), 0, true);
         display->flipDMABuffer();
-        delay(2000);
         return;
     }
 
-    // Get the current uptime
-    Serial.println("Uptime in minutes: " + String((millis() / 60000)));
+    formatClock(datestring, sizeof(datestring), &timeinfo);
 
-    display->clearScreen();
+    drawMonthDay(timeinfo.tm_mday, timeinfo.tm_hour);
 
-    Serial.println(F("Checking Spotify state"));
+    drawWeekDay(timeinfo.tm_wday, timeinfo.tm_hour);
 
-    response currentState = sp.currently_playing();
+    drawClock(datestring, getClockDigitColor(timeinfo.tm_hour, timeinfo.tm_min), 0, timeinfo.tm_hour <= NIGHT_END_HOUR || timeinfo.tm_hour >= NIGHT_START_HOUR);
 
-    /*
-    State
-      200 Information about playback
-      204 Playback not available or active
-      401 Bad or expired token. This can happen if the user revoked a token or the access token has expired. You should re-authenticate the user.
-      403 Bad OAuth request (wrong consumer key, bad nonce, expired timestamp...). Unfortunately, re-authenticating the user won't help here.
-      429 The app has exceeded its rate limits.
-    */
+    display->flipDMABuffer();
+    spotifyStatsFramePresented(nowPlaying.sequence);
+}
 
-    if (currentState.status_code != 200)
+// Everything that touches the network: WiFi recovery, Spotify auth and
+// polling, cover download and decode, and fleet traffic. Results reach the
+// render loop only through publishNowPlaying()
+void netTask(void *)
+{
+    unsigned long lastPoll = millis() - powerProfilePollIntervalMs();
+
+    for (;;)
     {
-        Serial.println("Error, code: " + String(currentState.status_code));
+        // Sync logs and the periodic NVS save; flash writes stay off the render loop
+        timeServiceUpdate();
 
-        if (currentState.status_code == 201)
+        // Reconnect if wifi is down
+        if (WiFi.status() != WL_CONNECTED)
         {
-            Serial.println(F("Spotify on inactive"));
-
-            isSpotifyPlaying = false;
+            LOG_W("Reconnecting to WiFi...");
+            WiFi.disconnect();
+            WiFi.reconnect();
         }
 
-        if(currentState.status_code == 204)
-        {
-            Serial.println(F("No content, playback not active"));
+        ensureSpotifyReady();
 
-            isSpotifyPlaying = false;
-        }
+        bool following = fleetIsFollower();
 
-        if (currentState.status_code == 401)
+        if (!spotifyAuthenticated && !following)
         {
-            Serial.println(F("The access token expired"));
-
-            sp.get_access_token();
-            currentState = sp.currently_playing();
+            LOG_EVERY_MS(60000, LOG_I("Spotify not ready, showing clock only"));
+            delay(2000);
+            continue;
         }
 
-        if (currentState.status_code == 403)
+        unsigned long interval = powerProfilePollIntervalMs();
+        if (following)
         {
-            Serial.println(F("Bad OAuth request"));
+            // Leader packets arrive on their own; checking them costs no I/O
+            followFleet();
+            interval = std::min<unsigned long>(interval, FLEET_FOLLOW_CHECK_MS);
+            lastPoll = millis();
         }
-
-        if (currentState.status_code == 429)
+        else if (millis() - lastPoll >= interval)
         {
-            Serial.println(F("The app has exceeded its rate limits."));
+            lastPoll = millis();
+            if (pollSpotify())
+                publishFleetState();
+            else
+                fleetPollFailed();
         }
 
-        if (currentState.reply["message"].as<String>().equals("Timeout receiving headers"))
-        {
-            Serial.println(F("Timeout receiving headers"));
-            currentState = sp.currently_playing();
-        }
+        publishNowPlaying();
+
+        unsigned long elapsed = millis() - lastPoll;
+        delay(elapsed < interval ? interval - elapsed : 1);
     }
+}
 
-    // check if is play is null
-    if (!currentState.reply["is_playing"].isNull())
+void setup()
+{
+    // Initialize USBSerial port
+    Serial.begin(115200);
+    memoryReportBegin();
+    logBegin();
+    netGuardBegin();
+    memoryReportMark("log/net guard");
+    LOG_I("Start!");
+
+    // Start led matrix
+    LOG_I("Led Matrix begin");
+    HUB75_I2S_CFG mxconfig(
+        PANEL_WIDTH,
+        PANEL_HEIGHT,
+        1,
+        MATRIX_PINS);
+
+    mxconfig.driver = HUB75_I2S_CFG::ICN2038S;
+    mxconfig.clkphase = false;
+    mxconfig.latch_blanking = 4;
+    mxconfig.i2sspeed = HUB75_I2S_CFG::HZ_10M;
+    mxconfig.double_buff = PANEL_DOUBLE_BUFFER;
+
+    // Display Setup
+    panelColorBegin(panelCalibrationLoad());
+    display = new ShadowPanel(mxconfig);
+    display->begin();
+    display->setBrightness8(DISPLAY_BRIGHTNESS);
+    display->clearScreen();
+    display->flipDMABuffer();
+    memoryReportMark("panel DMA");
+
+    // Album art and track name buffers live in PSRAM and are reused for every track
+    bool coversAllocated = true;
+    for (CoverBuffers &cover : covers)
     {
-        isSpotifyPlaying = currentState.reply["is_playing"].as<bool>();
+        cover.rgb = static_cast<uint8_t *>(heap_caps_calloc(PANEL_PIXELS, 3, MALLOC_CAP_SPIRAM));
+        cover.panel = static_cast<uint8_t *>(heap_caps_calloc(PANEL_PIXELS, 3, MALLOC_CAP_SPIRAM));
+        cover.frame = static_cast<uint16_t *>(heap_caps_calloc(PANEL_PIXELS, sizeof(uint16_t), MALLOC_CAP_SPIRAM));
+        coversAllocated = coversAllocated && cover.rgb && cover.panel && cover.frame;
     }
+    if (!coversAllocated || !marquee.begin() || !coverIngestBegin())
+    {
+        LOG_E("Not enough PSRAM for cover and marquee buffers");
+    }
+#if CLOCK_BACKDROP
+    backdropBegin(PANEL_WIDTH, PANEL_HEIGHT);
+    clockBackdrop = measureClockRegion();
+#endif
+    memoryReportMark("cover/marquee");
 
-    if (isSpotifyPlaying)
+#ifdef COLOR_TOOLS_SELFTEST
+    colorToolsSelfTest();
+#endif
+
+    // Initialize LittleFS
+    if (!LittleFS.begin(true))
+    {
+        LOG_E("LittleFS begin: failed");
+    }
+    else
     {
-        Serial.println(F("Spotify is playing"));
-        currentAlbumArtUrl = currentState.reply["item"]["album"]["images"][2]["url"].as<String>();
+        LOG_I("LittleFS begin: ok");
+    }
+    memoryReportMark("LittleFS");
 
-        if (!currentState.reply["item"]["album"]["images"][2]["url"].isNull())
-        {
+#ifdef COVER_INGEST_SELFTEST
+    decodeRgb = covers[0].rgb;
+    coverIngestSelfTest("/cover.jpg", drawMCU, []()
+                        { colorCounts.clear(); });
+#endif
 
-            if (!currentAlbumArtUrl.equals(previousAlbumArtUrl))
-            {
-                previousAlbumArtUrl = currentAlbumArtUrl;
-                int downloadResult = downloadImage(currentAlbumArtUrl);
+    // Initialize Wifi
+    LOG_I("WiFi begin");
 
-                Serial.println("Download result: " + String(downloadResult));
-            }
-        }
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    while (WiFi.status() != WL_CONNECTED)
+    {
+        delay(500);
+        LOG_EVERY_MS(5000, LOG_I("WiFi connecting..."));
+    }
+
+    if (WiFi.status() != WL_CONNECTED)
+    {
+        LOG_E("WiFi failed! Restarting...");
+        // ESP.restart();
+    }
+    else
+    {
 
-        drawJPEG("/cover.jpg", 0, 0);
+        LOG_I("RSSI : %d dB", WiFi.RSSI());
+        LOG_I("IP:%s", WiFi.localIP().toString().c_str());
 
-        struct tm timeinfo;
+        // Set primary DNS server
+        IPAddress primaryDNS(8, 8, 8, 8); // Google's DNS server
 
-        if (!getLocalTime(&timeinfo))
+        // Set secondary DNS server (optional)
+        IPAddress secondaryDNS(8, 8, 4, 4); // Google's secondary DNS server
+
+        // Apply DNS settings
+        if (WiFi.config(WiFi.localIP(), WiFi.gatewayIP(), WiFi.subnetMask(), primaryDNS, secondaryDNS))
+        {
+            LOG_I("DNS Server configuration successful");
+        }
+        else
         {
-            Serial.println(F("Failed to obtain time"));
+            LOG_W("DNS Server configuration failed");
         }
 
-        char datestring[6];
-        snprintf_P(datestring,
-                   countof(datestring),
-                   PSTR("%02u:%02u"),
-                   timeinfo.tm_hour,
-                   timeinfo.tm_min);
+        // Print the DNS server to verify
+        LOG_I("DNS Server: %s", WiFi.dnsIP().toString().c_str());
+    }
+    memoryReportMark("WiFi");
 
-        drawClock(datestring, mostPredominantColor, leastPredominantColor, true);
+    // Initialize mDNS
+    if (!MDNS.begin(PROJECTNAME))
+    {
+        LOG_E("mDNS begin: failed");
+        // ESP.restart();
     }
     else
     {
-        Serial.println(F("Spotify is not playing, drawing clock"));
+        // Set the hostname to "$PROJECTNAME.local"
+        LOG_I("mDNS begin: ok");
+        MDNS.addService("http", "tcp", FRAME_STREAM_PORT);
+    }
 
-        pixels.setPixelColor(0, pixels.Color(0, 0, 0));
-        pixels.show();
+#if FLEET_ENABLED
+    LOG_I("Fleet begin: %s", fleetBegin(PANEL_PIXELS * 3) ? "ok" : "failed");
+#endif
 
-        struct tm timeinfo;
+    // Serve the framebuffer mirror on http://$PROJECTNAME.local/
+    LOG_I("Frame stream begin: %s", frameStreamBegin(display) ? "ok" : "failed");
+    memoryReportMark("mDNS/stream");
+    memoryReportLog();
 
-        if (!getLocalTime(&timeinfo))
-        {
-            Serial.println(F("Failed to obtain time"));
-        }
+    // Initialize NTP; the clock shows the restored time until the first sync
+    timeServiceBegin();
 
-        char datestring[6];
-        snprintf_P(datestring,
-                   countof(datestring),
-                   PSTR("%02u:%02u"),
-                   timeinfo.tm_hour,
-                   timeinfo.tm_min);
+    pinMode(PIN_LED, OUTPUT);
+    pinMode(PIN_LIGHT_SENSOR, INPUT);
 
-        drawMonthDay(timeinfo.tm_mday, timeinfo.tm_hour);
+    renderIdleClock();
 
-        drawWeekDay(timeinfo.tm_wday, timeinfo.tm_hour);
+    pixels.begin(); // Initialize NeoPixel strip
+    pixels.setBrightness(NEOPIXEL_BRIGHTNESS);
 
-        drawClock(datestring, getClockDigitColor(timeinfo.tm_hour, timeinfo.tm_min), 0, timeinfo.tm_hour <= NIGHT_END_HOUR || timeinfo.tm_hour >= NIGHT_START_HOUR);
+    // Spotify, the cover download and fleet traffic run on their own task and
+    // only hand finished state to loop(); Spotify auth is started there too
+    nowPlayingLock = xSemaphoreCreateMutex();
+    renderTask = xTaskGetCurrentTaskHandle();
+    xTaskCreatePinnedToCore(netTask, "net", NET_TASK_STACK_SIZE, nullptr, NET_TASK_PRIORITY, nullptr, 0);
+}
+
+// Draws frames from the published state. Waits between frames on a task
+// notification, so a publish from the net task is shown at once
+void loop()
+{
+    unsigned long frameStart = millis();
+
+    xSemaphoreTake(nowPlayingLock, portMAX_DELAY);
+    applyNowPlaying();
+    {
+        AllocGuard guard("render");
 
-        currentAlbumArtUrl = "";
-        previousAlbumArtUrl = " ";
+        // Without a usable cover the clock-only scene is shown
+        if (nowPlaying.playing && nowPlaying.cover)
+        {
+            renderNowPlaying(nowPlaying);
+        }
+        else
+        {
+            renderIdleClock();
+        }
     }
 
-    display->flipDMABuffer();
-    delay(1000);
+    // Scrolling text and temporal dithering need a steady frame rate; otherwise
+    // the frame only changes with the minute or the next publish
+    bool animating = nowPlaying.playing && (marquee.isScrolling() || DITHER_TEMPORAL);
+    xSemaphoreGive(nowPlayingLock);
+
+    // Switch profiles between frames
+    powerProfileUpdate(display);
+
+    uint32_t wait;
+    if (animating)
+    {
+        uint32_t period = 1000 / MARQUEE_FPS;
+        uint32_t elapsed = millis() - frameStart;
+        wait = elapsed < period ? period - elapsed : 0;
+    }
+    else
+    {
+        wait = msUntilNextMinute(1000);
+    }
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
 }
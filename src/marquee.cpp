@@ -0,0 +1,270 @@
+#include <marquee.h>
+
+#define MARQUEE_STRIP_WIDTH (MARQUEE_MAX_CHARS * MARQUEE_GLYPH_WIDTH)
+// One row of outline above and below the glyphs
+#define MARQUEE_STRIP_HEIGHT (MARQUEE_GLYPH_HEIGHT + 2)
+
+// Adafruit_GFX target that writes into the column-major 1-bit strip
+class StripCanvas : public Adafruit_GFX
+{
+public:
+    StripCanvas(uint16_t *columns) : Adafruit_GFX(MARQUEE_STRIP_WIDTH, MARQUEE_STRIP_HEIGHT), columns(columns) {}
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override
+    {
+        if (x < 0 || y < 0 || x >= MARQUEE_STRIP_WIDTH || y >= MARQUEE_STRIP_HEIGHT)
+            return;
+        if (color)
+            columns[x] |= 1 << y;
+        else
+            columns[x] &= ~(1 << y);
+    }
+
+private:
+    uint16_t *columns;
+};
+
+// CP437 has most of Latin-1 as precomposed glyphs
+static uint8_t cp437FromLatin1(uint32_t cp)
+{
+    switch (cp)
+    {
+    case 0xC7: return 0x80; // Ç
+    case 0xFC: return 0x81; // ü
+    case 0xE9: return 0x82; // é
+    case 0xE2: return 0x83; // â
+    case 0xE4: return 0x84; // ä
+    case 0xE0: return 0x85; // à
+    case 0xE5: return 0x86; // å
+    case 0xE7: return 0x87; // ç
+    case 0xEA: return 0x88; // ê
+    case 0xEB: return 0x89; // ë
+    case 0xE8: return 0x8A; // è
+    case 0xEF: return 0x8B; // ï
+    case 0xEE: return 0x8C; // î
+    case 0xEC: return 0x8D; // ì
+    case 0xC4: return 0x8E; // Ä
+    case 0xC5: return 0x8F; // Å
+    case 0xC9: return 0x90; // É
+    case 0xE6: return 0x91; // æ
+    case 0xC6: return 0x92; // Æ
+    case 0xF4: return 0x93; // ô
+    case 0xF6: return 0x94; // ö
+    case 0xF2: return 0x95; // ò
+    case 0xFB: return 0x96; // û
+    case 0xF9: return 0x97; // ù
+    case 0xFF: return 0x98; // ÿ
+    case 0xD6: return 0x99; // Ö
+    case 0xDC: return 0x9A; // Ü
+    case 0xA2: return 0x9B; // ¢
+    case 0xA3: return 0x9C; // £
+    case 0xA5: return 0x9D; // ¥
+    case 0xE1: return 0xA0; // á
+    case 0xED: return 0xA1; // í
+    case 0xF3: return 0xA2; // ó
+    case 0xFA: return 0xA3; // ú
+    case 0xF1: return 0xA4; // ñ
+    case 0xD1: return 0xA5; // Ñ
+    case 0xAA: return 0xA6; // ª
+    case 0xBA: return 0xA7; // º
+    case 0xBF: return 0xA8; // ¿
+    case 0xAC: return 0xAA; // ¬
+    case 0xBD: return 0xAB; // ½
+    case 0xBC: return 0xAC; // ¼
+    case 0xA1: return 0xAD; // ¡
+    case 0xAB: return 0xAE; // «
+    case 0xBB: return 0xAF; // »
+    case 0xDF: return 0xE1; // ß
+    case 0xB5: return 0xE6; // µ
+    case 0xB1: return 0xF1; // ±
+    case 0xF7: return 0xF6; // ÷
+    case 0xB0: return 0xF8; // °
+    case 0xB7: return 0xFA; // ·
+    case 0xB2: return 0xFD; // ²
+    default: return 0;
+    }
+}
+
+// Base letters for U+00C0..U+00FF, used when CP437 has no precomposed glyph
+static const char latin1Letters[] = "AAAAAAAC"
+                                    "EEEEIIII"
+                                    "DNOOOOOx"
+                                    "OUUUUYPs"
+                                    "aaaaaaac"
+                                    "eeeeiiii"
+                                    "dnooooo/"
+                                    "ouuuuypy";
+
+uint8_t marqueeGlyphFor(uint32_t cp)
+{
+    if (cp >= 0x20 && cp < 0x7F)
+        return cp;
+
+    if (uint8_t glyph = cp437FromLatin1(cp))
+        return glyph;
+
+    if (cp >= 0xC0 && cp <= 0xFF)
+        return latin1Letters[cp - 0xC0];
+
+    switch (cp)
+    {
+    case 0xA0:   // no-break space
+    case 0x2009: // thin space
+        return ' ';
+    case 0x2010: // hyphens and dashes
+    case 0x2011:
+    case 0x2012:
+    case 0x2013:
+    case 0x2014:
+        return '-';
+    case 0x2018: // single quotes
+    case 0x2019:
+    case 0x00B4:
+        return '\'';
+    case 0x201C: // double quotes
+    case 0x201D:
+        return '"';
+    case 0x2022: // bullet
+        return 0xF9;
+    case 0x2026: // ellipsis
+        return '.';
+    default:
+        return '?';
+    }
+}
+
+// Decodes one UTF-8 sequence; malformed input yields U+FFFD and advances one byte
+static uint32_t nextCodepoint(const char *&s)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(s);
+    uint32_t cp;
+    int extra;
+
+    if (p[0] < 0x80)
+    {
+        s += 1;
+        return p[0];
+    }
+    else if ((p[0] & 0xE0) == 0xC0)
+    {
+        cp = p[0] & 0x1F;
+        extra = 1;
+    }
+    else if ((p[0] & 0xF0) == 0xE0)
+    {
+        cp = p[0] & 0x0F;
+        extra = 2;
+    }
+    else if ((p[0] & 0xF8) == 0xF0)
+    {
+        cp = p[0] & 0x07;
+        extra = 3;
+    }
+    else
+    {
+        s += 1;
+        return 0xFFFD;
+    }
+
+    for (int i = 1; i <= extra; i++)
+    {
+        if ((p[i] & 0xC0) != 0x80)
+        {
+            s += 1;
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (p[i] & 0x3F);
+    }
+
+    s += extra + 1;
+    return cp;
+}
+
+bool Marquee::begin()
+{
+    glyphs = static_cast<uint16_t *>(heap_caps_calloc(MARQUEE_STRIP_WIDTH, sizeof(uint16_t), MALLOC_CAP_SPIRAM));
+    outline = static_cast<uint16_t *>(heap_caps_calloc(MARQUEE_STRIP_WIDTH, sizeof(uint16_t), MALLOC_CAP_SPIRAM));
+    return glyphs && outline;
+}
+
+void Marquee::setText(const char *utf8)
+{
+    if (!glyphs || strncmp(text, utf8, sizeof(text) - 1) == 0)
+        return;
+
+    uint32_t start = micros();
+
+    strlcpy(text, utf8, sizeof(text));
+    memset(glyphs, 0, MARQUEE_STRIP_WIDTH * sizeof(uint16_t));
+    memset(outline, 0, MARQUEE_STRIP_WIDTH * sizeof(uint16_t));
+
+    StripCanvas canvas(glyphs);
+    canvas.cp437(true);
+
+    // Column 0 and the last spacing column are left free for the outline
+    int16_t x = 0;
+    const char *p = text;
+    while (*p && x + MARQUEE_GLYPH_WIDTH < MARQUEE_STRIP_WIDTH)
+    {
+        canvas.drawChar(1 + x, 1, marqueeGlyphFor(nextCodepoint(p)), 1, 0, 1);
+        x += MARQUEE_GLYPH_WIDTH;
+    }
+
+    stripWidth = x > 0 ? x + 1 : 0;
+
+    // Outline = 8-neighbour dilation of the glyph bits minus the glyphs
+    for (int16_t col = 0; col < stripWidth; col++)
+    {
+        uint16_t around = glyphs[col];
+        if (col > 0)
+            around |= glyphs[col - 1];
+        if (col + 1 < stripWidth)
+            around |= glyphs[col + 1];
+        outline[col] = (around | around << 1 | around >> 1) & ~glyphs[col];
+    }
+
+    startMs = millis();
+    renderMicros = micros() - start;
+}
+
+void Marquee::clear()
+{
+    text[0] = '\0';
+    stripWidth = 0;
+}
+
+void Marquee::draw(Adafruit_GFX *gfx, int16_t y, uint16_t color, uint16_t outlineColor, uint32_t nowMs)
+{
+    if (stripWidth == 0)
+        return;
+
+    uint32_t start = micros();
+    displayWidth = gfx->width();
+
+    // Short text stays centered; long text wraps around with a gap
+    int16_t period = stripWidth + MARQUEE_GAP_PX;
+    int16_t offset = isScrolling()
+                         ? ((nowMs - startMs) * MARQUEE_SPEED_PX_PER_SEC / 1000) % period
+                         : -(displayWidth - stripWidth) / 2;
+
+    for (int16_t x = 0; x < displayWidth; x++)
+    {
+        int16_t col = offset + x;
+        if (isScrolling())
+            col %= period;
+        if (col < 0 || col >= stripWidth)
+            continue;
+
+        uint16_t g = glyphs[col];
+        uint16_t o = outline[col];
+        for (int16_t row = 0; row < MARQUEE_STRIP_HEIGHT; row++)
+        {
+            if ((g >> row) & 1)
+                gfx->drawPixel(x, y + row - 1, color);
+            else if ((o >> row) & 1)
+                gfx->drawPixel(x, y + row - 1, outlineColor);
+        }
+    }
+
+    drawMicros = micros() - start;
+}
@@ -0,0 +1,51 @@
+#include <memory_report.h>
+#include <log.h>
+
+struct MemoryReportEntry
+{
+    const char *subsystem;
+    int32_t internalBytes;
+    int32_t psramBytes;
+};
+
+static MemoryReportEntry entries[MEMORY_REPORT_MAX_ENTRIES];
+static uint8_t entryCount = 0;
+static size_t lastInternalFree = 0;
+static size_t lastPsramFree = 0;
+
+void memoryReportBegin()
+{
+    entryCount = 0;
+    lastInternalFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    lastPsramFree = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+void memoryReportMark(const char *subsystem)
+{
+    size_t internalFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    size_t psramFree = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+
+    if (entryCount < MEMORY_REPORT_MAX_ENTRIES)
+    {
+        entries[entryCount++] = {subsystem,
+                                 (int32_t)lastInternalFree - (int32_t)internalFree,
+                                 (int32_t)lastPsramFree - (int32_t)psramFree};
+    }
+
+    lastInternalFree = internalFree;
+    lastPsramFree = psramFree;
+}
+
+void memoryReportLog()
+{
+    LOG_I("Memory use by subsystem (internal / PSRAM bytes):");
+    for (uint8_t i = 0; i < entryCount; i++)
+    {
+        LOG_I("  %-14s %7ld / %7ld", entries[i].subsystem, (long)entries[i].internalBytes, (long)entries[i].psramBytes);
+    }
+    LOG_I("Internal free %u, largest block %u, minimum ever %u",
+          heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+          heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL),
+          heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+    LOG_I("PSRAM free %u of %u", heap_caps_get_free_size(MALLOC_CAP_SPIRAM), heap_caps_get_total_size(MALLOC_CAP_SPIRAM));
+}
@@ -0,0 +1,205 @@
+#include <net_guard.h>
+#include <log.h>
+#include <atomic>
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include <esp_timer.h>
+
+#define NET_MONITOR_PERIOD_MS 250
+#define NET_RESTART_FLUSH_MS 100 // lets the log task write why before restarting
+#define NET_STALL_MAGIC 0x4E455447 // "NETG"
+
+// Survives a software or watchdog reset, not a power cycle
+struct NetStallRecord
+{
+    uint32_t magic;
+    uint32_t stage;
+    uint32_t elapsedMs;
+};
+
+RTC_NOINIT_ATTR static NetStallRecord stallRecord;
+
+static std::atomic<uint8_t> activeStage{NET_STAGE_IDLE};
+static std::atomic<uint32_t> activeStartMs{0};
+static std::atomic<uint32_t> activeBudgetMs{0};
+static std::atomic<uint32_t> activeProgressMs{0};
+static std::atomic<bool> cancelRequested{false};
+static std::atomic<bool> overrunReported{false};
+static std::atomic<bool> restartRequested{false};
+static TaskHandle_t restartTask = nullptr;
+
+static const char *const stageNames[NET_STAGE_COUNT] = {
+    "idle",
+    "connectivity check",
+    "Spotify poll",
+    "token refresh",
+    "cover request",
+    "cover body",
+};
+
+const char *netStageName(NetStage stage)
+{
+    return stage < NET_STAGE_COUNT ? stageNames[stage] : "?";
+}
+
+static void recordStage(uint8_t stage, uint32_t elapsedMs)
+{
+    stallRecord.stage = stage;
+    stallRecord.elapsedMs = elapsedMs;
+    stallRecord.magic = NET_STALL_MAGIC;
+}
+
+NetOperation::NetOperation(NetStage stage, uint32_t budgetMs) : startMs(millis()), budgetMs(budgetMs)
+{
+    activeStartMs.store(startMs, std::memory_order_relaxed);
+    activeBudgetMs.store(budgetMs, std::memory_order_relaxed);
+    activeProgressMs.store(startMs, std::memory_order_relaxed);
+    cancelRequested.store(false, std::memory_order_relaxed);
+    overrunReported.store(false, std::memory_order_relaxed);
+    activeStage.store(stage, std::memory_order_release);
+    recordStage(stage, 0);
+
+    // The calling task is watched only while it is inside a network call
+    watchdogAdded = esp_task_wdt_add(nullptr) == ESP_OK;
+}
+
+NetOperation::~NetOperation()
+{
+    NetStage stage = static_cast<NetStage>(activeStage.exchange(NET_STAGE_IDLE, std::memory_order_acq_rel));
+    recordStage(NET_STAGE_IDLE, 0);
+    if (watchdogAdded)
+        esp_task_wdt_delete(nullptr);
+
+    uint32_t elapsed = elapsedMs();
+    if (elapsed > budgetMs)
+    {
+        LOG_W("Network %s took %" PRIu32 " ms (budget %" PRIu32 " ms)", netStageName(stage), elapsed, budgetMs);
+    }
+}
+
+void NetOperation::stage(NetStage next)
+{
+    activeStage.store(next, std::memory_order_release);
+    recordStage(next, elapsedMs());
+    progress();
+}
+
+void NetOperation::progress()
+{
+    activeProgressMs.store(millis(), std::memory_order_relaxed);
+    if (watchdogAdded)
+        esp_task_wdt_reset();
+}
+
+bool NetOperation::expired() const
+{
+    return cancelRequested.load(std::memory_order_relaxed) || elapsedMs() >= budgetMs;
+}
+
+uint32_t NetOperation::elapsedMs() const
+{
+    return millis() - startMs;
+}
+
+uint32_t NetOperation::remainingMs() const
+{
+    uint32_t elapsed = elapsedMs();
+    return elapsed < budgetMs ? budgetMs - elapsed : 0;
+}
+
+void netCancel()
+{
+    cancelRequested.store(true, std::memory_order_relaxed);
+}
+
+// Waits for monitorTick() to ask for a restart. The timer callback must not
+// block, and the log task needs a moment to write the reason first.
+static void restartTaskMain(void *)
+{
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    delay(NET_RESTART_FLUSH_MS);
+    esp_restart();
+}
+
+static void requestRestart()
+{
+    if (restartRequested.exchange(true, std::memory_order_relaxed))
+        return;
+    if (restartTask)
+        xTaskNotifyGive(restartTask);
+    else
+        esp_restart(); // no task to flush from, restarting matters more
+}
+
+// Runs in the esp_timer task, so it keeps going while the net task is blocked
+static void monitorTick(void *)
+{
+    uint8_t stage = activeStage.load(std::memory_order_acquire);
+    if (stage == NET_STAGE_IDLE || restartRequested.load(std::memory_order_relaxed))
+        return;
+
+    uint32_t now = millis();
+    uint32_t elapsed = now - activeStartMs.load(std::memory_order_relaxed);
+    uint32_t budget = activeBudgetMs.load(std::memory_order_relaxed);
+    uint32_t idle = now - activeProgressMs.load(std::memory_order_relaxed);
+    stallRecord.elapsedMs = elapsed;
+
+    if (elapsed > budget && !overrunReported.exchange(true, std::memory_order_relaxed))
+    {
+        LOG_W("Network stalled in %s for %" PRIu32 " ms, cancelling", netStageName(static_cast<NetStage>(stage)), elapsed);
+        cancelRequested.store(true, std::memory_order_relaxed);
+    }
+
+    if (idle > NET_WATCHDOG_S * 1000)
+    {
+        LOG_E("Network %s made no progress for %" PRIu32 " ms, restarting", netStageName(static_cast<NetStage>(stage)), idle);
+        requestRestart();
+        return;
+    }
+
+#if NET_STALL_RESTART_MS > 0
+    if (elapsed > NET_STALL_RESTART_MS)
+    {
+        LOG_E("Network stuck in %s for %" PRIu32 " ms, restarting", netStageName(static_cast<NetStage>(stage)), elapsed);
+        requestRestart();
+    }
+#endif
+}
+
+void netGuardBegin()
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (reason != ESP_RST_POWERON && stallRecord.magic == NET_STALL_MAGIC &&
+        stallRecord.stage != NET_STAGE_IDLE && stallRecord.stage < NET_STAGE_COUNT)
+    {
+        LOG_W("Previous reset (reason %d) happened in network %s, %" PRIu32 " ms into the operation",
+              reason, netStageName(static_cast<NetStage>(stallRecord.stage)), stallRecord.elapsedMs);
+    }
+    recordStage(NET_STAGE_IDLE, 0);
+
+    // The default 5 s would fire in the middle of a call that is still
+    // within its budget. Panic stays off: it would apply to every subscribed
+    // task, and monitorTick() restarts for a stuck net task.
+    if (esp_task_wdt_init(NET_WATCHDOG_S, false) != ESP_OK)
+    {
+        LOG_E("Task watchdog timeout not set");
+    }
+
+    // On the render core, so a net task spinning on core 0 cannot starve it
+    if (xTaskCreatePinnedToCore(restartTaskMain, "netRestart", 2048, nullptr, NET_TASK_PRIORITY + 1, &restartTask, 1) != pdPASS)
+    {
+        restartTask = nullptr;
+        LOG_E("Network restart task failed");
+    }
+
+    esp_timer_create_args_t args = {};
+    args.callback = monitorTick;
+    args.name = "netGuard";
+    esp_timer_handle_t timer;
+    if (esp_timer_create(&args, &timer) != ESP_OK ||
+        esp_timer_start_periodic(timer, NET_MONITOR_PERIOD_MS * 1000) != ESP_OK)
+    {
+        LOG_E("Network monitor timer failed");
+    }
+}
@@ -0,0 +1,66 @@
+#include <panel_color.h>
+#include <log.h>
+#include <Preferences.h>
+#include <nvs.h>
+#include <cmath>
+
+// Preferences::begin() logs an error when the namespace was never written,
+// which is the case on every panel nobody calibrated; look for it first
+static bool calibrationStored()
+{
+    nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, "panel", NVS_TYPE_ANY);
+    if (!it)
+        return false;
+    nvs_release_iterator(it);
+    return true;
+}
+
+static bool loadFromNvs(PanelCalibration &target)
+{
+    static const char *const gammaKeys[3] = {"gamma_r", "gamma_g", "gamma_b"};
+    static const char *const whiteKeys[3] = {"white_r", "white_g", "white_b"};
+
+    Preferences prefs;
+    if (!calibrationStored() || !prefs.begin("panel", true))
+        return false;
+
+    PanelCalibration loaded = target;
+    bool found = false;
+    bool valid = true;
+    for (int c = 0; c < 3; c++)
+    {
+        if (prefs.isKey(gammaKeys[c]))
+        {
+            loaded.gamma[c] = prefs.getFloat(gammaKeys[c], loaded.gamma[c]);
+            valid &= loaded.gamma[c] >= PANEL_GAMMA_MIN && loaded.gamma[c] <= PANEL_GAMMA_MAX;
+            found = true;
+        }
+        if (prefs.isKey(whiteKeys[c]))
+        {
+            loaded.white[c] = prefs.getUShort(whiteKeys[c], loaded.white[c]);
+            valid &= loaded.white[c] >= 1 && loaded.white[c] <= 256;
+            found = true;
+        }
+    }
+    prefs.end();
+
+    if (found && !valid)
+    {
+        LOG_W("Panel calibration in NVS is out of range, using build settings");
+        return false;
+    }
+    if (found)
+        target = loaded;
+    return found;
+}
+
+PanelCalibration panelCalibrationLoad()
+{
+    PanelCalibration calibration = PANEL_CALIBRATION_DEFAULT;
+    bool fromNvs = loadFromNvs(calibration);
+
+    LOG_I("Panel calibration from %s: gamma x100 %d/%d/%d, white %u/%u/%u",
+          fromNvs ? "NVS" : "build", (int)lroundf(calibration.gamma[0] * 100), (int)lroundf(calibration.gamma[1] * 100),
+          (int)lroundf(calibration.gamma[2] * 100), calibration.white[0], calibration.white[1], calibration.white[2]);
+    return calibration;
+}
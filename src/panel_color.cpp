@@ -0,0 +1,119 @@
+#include <panel_color.h>
+#include <color_channels.h>
+#include <cmath>
+
+uint16_t panelGammaLut[3][256];
+uint16_t panelLevelLinear[256];
+uint8_t panelRed5[32];
+uint8_t panelGreen6[64];
+uint8_t panelBlue5[32];
+
+static PanelCalibration calibration = PANEL_CALIBRATION_DEFAULT;
+
+// Error rows for Floyd-Steinberg, one pixel of padding on each side
+static int32_t errorRows[2][(DITHER_MAX_WIDTH + 2) * 3];
+
+void panelColorBegin(const PanelCalibration &cal)
+{
+    calibration = cal;
+
+    for (int c = 0; c < 3; c++)
+    {
+        float scale = 65535.0f * cal.white[c] / 256.0f;
+        for (int i = 0; i < 256; i++)
+        {
+            panelGammaLut[c][i] = lroundf(powf(i / 255.0f, cal.gamma[c]) * scale);
+        }
+    }
+
+    for (int level = 0; level <= PANEL_LEVELS; level++)
+    {
+        panelLevelLinear[level] = (uint32_t)level * 65535 / PANEL_LEVELS;
+    }
+
+    for (int i = 0; i < 32; i++)
+    {
+        panelRed5[i] = panelLevelToByte(panelQuantize(panelGammaLut[0][R5_TO_R8(i)]));
+        panelBlue5[i] = panelLevelToByte(panelQuantize(panelGammaLut[2][R5_TO_R8(i)]));
+    }
+    for (int i = 0; i < 64; i++)
+    {
+        panelGreen6[i] = panelLevelToByte(panelQuantize(panelGammaLut[1][G6_TO_G8(i)]));
+    }
+}
+
+PanelCalibration panelCalibration()
+{
+    return calibration;
+}
+
+bool ditherErrorDiffusion(const uint8_t *src, uint8_t *dst, int width, int height)
+{
+    // Clamping would leave the rows misaligned with the source stride
+    if (width < 1 || width > DITHER_MAX_WIDTH)
+        return false;
+
+    memset(errorRows, 0, sizeof(errorRows));
+
+    for (int y = 0; y < height; y++)
+    {
+        int32_t *current = errorRows[y & 1];
+        int32_t *next = errorRows[(y + 1) & 1];
+        memset(next, 0, sizeof(errorRows[0]));
+
+        for (int x = 0; x < width; x++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                int i = (y * width + x) * 3 + c;
+                int e = (x + 1) * 3 + c;
+
+                // Errors are kept in 1/16 units so the 7-3-5-1 weights stay exact
+                int32_t value = panelGammaLut[c][src[i]] + current[e] / 16;
+                value = value < 0 ? 0 : value > 65535 ? 65535 : value;
+
+                uint8_t level = panelQuantize(value);
+                dst[i] = panelLevelToByte(level);
+
+                int32_t error = value - panelLevelLinear[level];
+                current[e + 3] += error * 7;
+                next[e - 3] += error * 3;
+                next[e] += error * 5;
+                next[e + 3] += error;
+            }
+        }
+    }
+    return true;
+}
+
+static const uint8_t bayer4x4[16] = {
+    0, 8, 2, 10,
+    12, 4, 14, 6,
+    3, 11, 1, 9,
+    15, 7, 13, 5};
+
+void ditherOrdered(const uint8_t *src, uint8_t *dst, int width, int height, uint32_t frame)
+{
+    // One quantization step in linear units, split into 16 thresholds
+    const uint32_t step = 65535 / PANEL_LEVELS;
+    const int shiftX = frame & 3;
+    const int shiftY = (frame >> 2) & 3;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            uint32_t threshold = (bayer4x4[((y + shiftY) & 3) * 4 + ((x + shiftX) & 3)] * 2 + 1) * step / 32;
+            for (int c = 0; c < 3; c++)
+            {
+                int i = (y * width + x) * 3 + c;
+                uint32_t linear = panelGammaLut[c][src[i]];
+                // Floor to the level below, then step up if past the threshold
+                uint32_t level = linear * PANEL_LEVELS / 65535;
+                if (level < PANEL_LEVELS && linear - panelLevelLinear[level] > threshold)
+                    level++;
+                dst[i] = panelLevelToByte(level);
+            }
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#include <power_profile.h>
+#include <log.h>
+#include <time_service.h>
+#include <WiFi.h>
+
+static PowerProfile current = POWER_PROFILE_DAY;
+static uint32_t dayCpuFreqMhz = 0;
+
+void powerProfileUpdate(MatrixPanel_I2S_DMA *display)
+{
+    PowerProfile wanted = POWER_PROFILE_DAY;
+    struct tm local;
+    if (timeLocal(local) && isNightHour(local.tm_hour))
+    {
+        wanted = POWER_PROFILE_NIGHT;
+    }
+
+    if (wanted == current)
+        return;
+
+    if (dayCpuFreqMhz == 0)
+        dayCpuFreqMhz = getCpuFrequencyMhz();
+
+    // The panel DMA is clocked from the PLL, not the CPU, so neither step disturbs refresh
+    if (wanted == POWER_PROFILE_NIGHT)
+    {
+        setCpuFrequencyMhz(NIGHT_CPU_FREQ_MHZ);
+        WiFi.setSleep(WIFI_PS_MAX_MODEM);
+        display->setBrightness8(NIGHT_DISPLAY_BRIGHTNESS);
+    }
+    else
+    {
+        setCpuFrequencyMhz(dayCpuFreqMhz);
+        WiFi.setSleep(WIFI_PS_MIN_MODEM);
+        display->setBrightness8(DISPLAY_BRIGHTNESS);
+    }
+
+    current = wanted;
+    LOG_I("Power profile: %s, CPU %" PRIu32 " MHz, brightness %u, poll every %" PRIu32 " ms",
+          current == POWER_PROFILE_NIGHT ? "night" : "day", getCpuFrequencyMhz(),
+          current == POWER_PROFILE_NIGHT ? NIGHT_DISPLAY_BRIGHTNESS : DISPLAY_BRIGHTNESS,
+          powerProfilePollIntervalMs());
+}
+
+PowerProfile powerProfileCurrent()
+{
+    return current;
+}
+
+uint32_t powerProfilePollIntervalMs()
+{
+    return current == POWER_PROFILE_NIGHT ? NIGHT_SPOTIFY_POLL_INTERVAL_MS : SPOTIFY_POLL_INTERVAL_MS;
+}
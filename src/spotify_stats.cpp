@@ -0,0 +1,237 @@
+#include <spotify_stats.h>
+#include <net_guard.h>
+#include <log.h>
+#ifdef SPOTIFY_MOCK_HOST
+#include <HTTPClient.h>
+#endif
+
+struct ChangeTiming
+{
+    uint32_t startMs;
+    uint32_t requestMs;
+    uint32_t downloadMs;
+    uint32_t decodeMs;
+};
+
+// The net task counts requests and measures changes, the render task closes
+// them on the first frame that shows them; both sides go through statsLock
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+static SpotifyStats stats = {};
+static ChangeTiming pending = {};
+static uint32_t pendingSequence = 0; // snapshot that carries the change, 0 = none
+static uint32_t lastChangeMs[4] = {}; // latency, request, download, decode
+
+// Net task only
+static ChangeTiming change = {};
+static bool changeOpen = false;
+
+// Render task only
+static uint32_t lastReportMs = 0;
+
+#ifdef SPOTIFY_MOCK_HOST
+// Same request the library makes, sent to tools/mock_spotify.py. Header
+// timeouts and unreadable bodies are reported the way the library does.
+static response mockRequest(const char *path, bool post)
+{
+    response state;
+    HTTPClient http;
+    http.setConnectTimeout(NET_CONNECT_TIMEOUT_MS);
+    http.setTimeout(NET_READ_TIMEOUT_MS);
+    http.useHTTP10(true);
+
+    if (!http.begin(SPOTIFY_MOCK_HOST, SPOTIFY_MOCK_PORT, path))
+    {
+        state.status_code = -1;
+        return state;
+    }
+
+    uint32_t report[5];
+    taskENTER_CRITICAL(&statsLock);
+    report[0] = stats.trackChanges;
+    memcpy(report + 1, lastChangeMs, sizeof(lastChangeMs));
+    taskEXIT_CRITICAL(&statsLock);
+
+    char header[64];
+    snprintf(header, sizeof(header), "%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32,
+             report[0], report[1], report[2], report[3], report[4]);
+    http.addHeader("X-Clock-Change", header);
+    http.addHeader("Authorization", "Bearer mock");
+
+    if (post)
+    {
+        http.addHeader("Content-Type", "application/x-www-form-urlencoded");
+        state.status_code = http.POST("grant_type=refresh_token");
+    }
+    else
+    {
+        state.status_code = http.GET();
+    }
+
+    if (state.status_code == HTTPC_ERROR_READ_TIMEOUT)
+    {
+        state.reply["message"] = "Timeout receiving headers";
+    }
+    else if (state.status_code > 0 && http.getSize() != 0)
+    {
+        DeserializationError error = deserializeJson(state.reply, http.getStream());
+        if (error)
+        {
+            LOG_W("Mock reply unreadable: %s", error.c_str());
+            state.status_code = -1;
+            state.reply.clear();
+        }
+    }
+
+    http.end();
+    return state;
+}
+#endif
+
+response spotifyStatsCurrentlyPlaying(Spotify &sp)
+{
+    uint32_t start = micros();
+#ifdef SPOTIFY_MOCK_HOST
+    (void)sp;
+    response state = mockRequest("/v1/me/player/currently-playing", false);
+#else
+    response state = sp.currently_playing();
+#endif
+    uint32_t elapsed = micros() - start;
+
+    taskENTER_CRITICAL(&statsLock);
+    stats.requests++;
+    stats.requestMicrosTotal += elapsed;
+    stats.requestMicrosMax = std::max(stats.requestMicrosMax, elapsed);
+
+    if (strcmp(state.reply["message"] | "", "Timeout receiving headers") == 0)
+        stats.timeouts++;
+    else if (state.status_code == 200)
+        stats.ok++;
+    else if (state.status_code == 204)
+        stats.noContent++;
+    else if (state.status_code == 401)
+        stats.unauthorized++;
+    else if (state.status_code == 429)
+        stats.rateLimited++;
+    else
+        stats.otherErrors++;
+    taskEXIT_CRITICAL(&statsLock);
+
+    return state;
+}
+
+void spotifyStatsRefreshToken(Spotify &sp)
+{
+    taskENTER_CRITICAL(&statsLock);
+    stats.tokenRefreshes++;
+    taskEXIT_CRITICAL(&statsLock);
+#ifdef SPOTIFY_MOCK_HOST
+    (void)sp;
+    response state = mockRequest("/api/token", true);
+    LOG_I("Mock token refresh, code: %d", state.status_code);
+#else
+    sp.get_access_token();
+#endif
+}
+
+void spotifyStatsChangeBegin(uint32_t pollStartMs, uint32_t requestMs)
+{
+    change = {pollStartMs, requestMs, 0, 0};
+    changeOpen = true;
+}
+
+void spotifyStatsChangeStages(uint32_t downloadMs, uint32_t decodeMs)
+{
+    change.downloadMs = downloadMs;
+    change.decodeMs = decodeMs;
+}
+
+void spotifyStatsChangePublished(uint32_t sequence)
+{
+    if (!changeOpen)
+        return;
+    changeOpen = false;
+
+    taskENTER_CRITICAL(&statsLock);
+    pending = change;
+    pendingSequence = sequence;
+    taskEXIT_CRITICAL(&statsLock);
+}
+
+// Upper bound of the bucket holding the given fraction of the samples
+static uint32_t latencyPercentile(const SpotifyStats &current, uint32_t permille)
+{
+    uint32_t target = (current.trackChanges * permille + 999) / 1000;
+    uint32_t seen = 0;
+    for (int i = 0; i < SPOTIFY_LATENCY_BUCKETS; i++)
+    {
+        seen += current.latencyHistogram[i];
+        if (seen >= target)
+            return 1u << (i + 4);
+    }
+    return current.latencyMsMax;
+}
+
+void spotifyStatsFramePresented(uint32_t sequence)
+{
+    uint32_t now = millis();
+
+    bool closed = false;
+    ChangeTiming timing = {};
+    uint32_t latency = 0;
+    taskENTER_CRITICAL(&statsLock);
+    if (pendingSequence && sequence >= pendingSequence)
+    {
+        pendingSequence = 0;
+        closed = true;
+        timing = pending;
+        latency = now - timing.startMs;
+
+        int bucket = 0;
+        while (bucket < SPOTIFY_LATENCY_BUCKETS - 1 && latency >= (1u << (bucket + 4)))
+            bucket++;
+        if (stats.latencyHistogram[bucket] < UINT16_MAX)
+            stats.latencyHistogram[bucket]++;
+        stats.trackChanges++;
+        stats.latencyMsMax = std::max(stats.latencyMsMax, latency);
+        lastChangeMs[0] = latency;
+        lastChangeMs[1] = timing.requestMs;
+        lastChangeMs[2] = timing.downloadMs;
+        lastChangeMs[3] = timing.decodeMs;
+    }
+    taskEXIT_CRITICAL(&statsLock);
+
+    if (closed)
+    {
+        LOG_I_DEFER("Track change on panel after %" PRIu32 " ms (request %" PRIu32 ", download %" PRIu32 ", decode %" PRIu32 ")",
+                    latency, timing.requestMs, timing.downloadMs, timing.decodeMs);
+    }
+
+    if (now - lastReportMs < SPOTIFY_STATS_REPORT_MS)
+        return;
+    lastReportMs = now;
+
+    SpotifyStats current = spotifyStats();
+    if (current.requests == 0)
+        return;
+
+    LOG_I_DEFER("Spotify requests: %" PRIu32 " (200: %" PRIu32 ", 204: %" PRIu32 ", 401: %" PRIu32 ", 429: %" PRIu32 ", timeout: %" PRIu32 ")",
+                current.requests, current.ok, current.noContent, current.unauthorized, current.rateLimited, current.timeouts);
+    LOG_I_DEFER("Spotify request time: avg %" PRIu32 " ms, max %" PRIu32 " ms, other errors: %" PRIu32 ", token refreshes: %" PRIu32,
+                (uint32_t)(current.requestMicrosTotal / current.requests / 1000), current.requestMicrosMax / 1000,
+                current.otherErrors, current.tokenRefreshes);
+
+    if (current.trackChanges)
+    {
+        LOG_I_DEFER("Track changes: %" PRIu32 ", latency p50 < %" PRIu32 " ms, p95 < %" PRIu32 " ms, max %" PRIu32 " ms",
+                    current.trackChanges, latencyPercentile(current, 500), latencyPercentile(current, 950), current.latencyMsMax);
+    }
+}
+
+SpotifyStats spotifyStats()
+{
+    taskENTER_CRITICAL(&statsLock);
+    SpotifyStats copy = stats;
+    taskEXIT_CRITICAL(&statsLock);
+    return copy;
+}
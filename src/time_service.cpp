@@ -0,0 +1,236 @@
+#include <time_service.h>
+#include <log.h>
+#include <Preferences.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <sys/time.h>
+
+#define TIME_VALID_AFTER 1600000000 // anything earlier means the clock was never set
+#define TIME_MAX_DRIFT_PPB 500000   // crystals are within +-100 ppm; larger means a bad sample
+#define TIME_MIN_DRIFT_INTERVAL_US (10 * 60 * 1000000LL)
+
+static portMUX_TYPE timeLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Shared with the SNTP callback, guarded by timeLock
+static int64_t anchorMonoUs = 0;
+static int64_t anchorEpochUs = 0;
+static int64_t driftPpb = 0;
+static int64_t lastServedUs = 0;
+static int64_t lastSyncMonoUs = 0;
+static TimeQuality quality = TIME_UNSET;
+static uint32_t syncCount = 0;
+static int32_t lastOffsetMs = 0;
+static int64_t floorEpochUs = 0; // last time saved to NVS; no real time can be earlier
+static uint32_t rejectedSyncs = 0;
+static int64_t rejectedOffsetUs = 0; // epoch minus monotonic time of the last rejected reply
+static uint8_t agreeingRejects = 0;  // rejected replies in a row that agree with each other
+static uint32_t floorOverrides = 0;
+
+// Loop task only
+static time_t cachedSecond = 0;
+static struct tm cachedLocal = {};
+
+// Net task only
+static int64_t lastSaveMonoUs = 0;
+static uint32_t savedOverrides = 0;
+
+static int64_t estimateLocked(int64_t monoUs)
+{
+    int64_t elapsed = monoUs - anchorMonoUs;
+    return anchorEpochUs + elapsed + elapsed * driftPpb / 1000000000;
+}
+
+static void anchorLocked(int64_t monoUs, int64_t epochUs)
+{
+    anchorMonoUs = monoUs;
+    anchorEpochUs = epochUs;
+}
+
+// Runs in the lwIP task after every SNTP update
+static void onTimeSync(struct timeval *tv)
+{
+    int64_t monoUs = esp_timer_get_time();
+    int64_t ntpUs = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+
+    portENTER_CRITICAL(&timeLock);
+    bool overridden = false;
+    if (ntpUs < floorEpochUs)
+    {
+        // Older than a time this clock already confirmed: a bogus server
+        // reply, unless several in a row agree, in which case the saved
+        // time was the bogus one
+        int64_t offset = ntpUs - monoUs;
+        bool agrees = agreeingRejects && std::abs(offset - rejectedOffsetUs) <= TIME_FLOOR_AGREE_MS * 1000LL;
+        agreeingRejects = agrees ? agreeingRejects + 1 : 1;
+        rejectedOffsetUs = offset;
+        rejectedSyncs++;
+        if (agreeingRejects < TIME_FLOOR_OVERRIDE_SYNCS)
+        {
+            portEXIT_CRITICAL(&timeLock);
+            return;
+        }
+        floorEpochUs = (int64_t)TIME_VALID_AFTER * 1000000;
+        floorOverrides++;
+        overridden = true;
+    }
+    agreeingRejects = 0;
+
+    if (quality == TIME_SYNCED && !overridden)
+    {
+        int64_t offset = ntpUs - estimateLocked(monoUs);
+        int64_t interval = monoUs - lastSyncMonoUs;
+        lastOffsetMs = offset / 1000;
+
+        // Blend a quarter of the measured rate error into the estimate
+        if (interval >= TIME_MIN_DRIFT_INTERVAL_US)
+        {
+            driftPpb += offset * 1000000000 / interval / 4;
+            driftPpb = std::max<int64_t>(-TIME_MAX_DRIFT_PPB, std::min<int64_t>(TIME_MAX_DRIFT_PPB, driftPpb));
+        }
+    }
+    else
+    {
+        // A restored time or a replaced floor may have been ahead; this sync
+        // is allowed to step back
+        lastServedUs = 0;
+    }
+    anchorLocked(monoUs, ntpUs);
+    lastSyncMonoUs = monoUs;
+    quality = TIME_SYNCED;
+    syncCount++;
+    portEXIT_CRITICAL(&timeLock);
+}
+
+static int64_t nowEpochUs()
+{
+    int64_t monoUs = esp_timer_get_time();
+
+    portENTER_CRITICAL(&timeLock);
+    int64_t now = 0;
+    if (quality != TIME_UNSET)
+    {
+        // A sync that moved the clock back holds it still instead of rewinding
+        now = std::max(estimateLocked(monoUs), lastServedUs);
+        lastServedUs = now;
+    }
+    portEXIT_CRITICAL(&timeLock);
+    return now;
+}
+
+void timeServiceBegin()
+{
+    // The time saved in NVS is only a lower bound: after a power cycle the
+    // clock could have been off for minutes or months, so showing it would
+    // be wrong. It still rules out an RTC or SNTP time from before it.
+    Preferences prefs;
+    int64_t saved = 0;
+    if (prefs.begin("time", true))
+    {
+        saved = prefs.getLong64("last", 0);
+        prefs.end();
+    }
+    int64_t floorUs = saved > TIME_VALID_AFTER ? saved * 1000000 : (int64_t)TIME_VALID_AFTER * 1000000;
+
+    // The RTC keeps counting across a software reset, but not a power cycle
+    timeval rtc;
+    gettimeofday(&rtc, nullptr);
+    int64_t rtcUs = (int64_t)rtc.tv_sec * 1000000 + rtc.tv_usec;
+    bool restored = rtcUs > floorUs;
+
+    portENTER_CRITICAL(&timeLock);
+    floorEpochUs = floorUs;
+    if (restored)
+    {
+        anchorLocked(esp_timer_get_time(), rtcUs);
+        quality = TIME_RESTORED;
+    }
+    portEXIT_CRITICAL(&timeLock);
+    LOG_I("Time restored from %s", restored ? "RTC" : "nowhere, waiting for SNTP");
+
+    sntp_set_time_sync_notification_cb(onTimeSync);
+    setenv("TZ", TZ_STRING, 1);                                                              // Set timezone
+    configTime(NTP_GMT_OFFSET_SECONDS, NTP_DAYLIGHT_OFFSET_SECONDS, ntpServer1, ntpServer2); // Start SNTP, does not wait
+}
+
+void timeServiceUpdate()
+{
+    TimeStatus status = timeStatus();
+
+    static uint32_t loggedRejects = 0;
+    if (status.rejectedSyncs != loggedRejects)
+    {
+        loggedRejects = status.rejectedSyncs;
+        LOG_W_DEFER("SNTP time older than the last saved time ignored (#%" PRIu32 ")", status.rejectedSyncs);
+    }
+
+    if (status.quality != TIME_SYNCED)
+        return;
+
+    // A replaced floor is rewritten right away, or the next boot rejects again
+    bool overridden = status.floorOverrides != savedOverrides;
+    if (overridden)
+    {
+        savedOverrides = status.floorOverrides;
+        LOG_W("Saved time was ahead of %d agreeing SNTP replies, replacing it", TIME_FLOOR_OVERRIDE_SYNCS);
+    }
+
+    static uint32_t loggedSyncs = 0;
+    if (status.syncCount != loggedSyncs)
+    {
+        loggedSyncs = status.syncCount;
+        LOG_I_DEFER("Time synced (#%" PRIu32 "), offset %" PRId32 " ms, drift %" PRId32 " ppb",
+                    status.syncCount, status.lastOffsetMs, status.driftPpb);
+    }
+
+    int64_t monoUs = esp_timer_get_time();
+    if (!overridden && lastSaveMonoUs && monoUs - lastSaveMonoUs < TIME_SAVE_INTERVAL_MS * 1000LL)
+        return;
+    lastSaveMonoUs = monoUs;
+
+    Preferences prefs;
+    prefs.begin("time", false);
+    prefs.putLong64("last", nowEpochUs() / 1000000);
+    prefs.end();
+}
+
+bool timeLocal(struct tm &out)
+{
+    int64_t nowUs = nowEpochUs();
+    if (nowUs == 0)
+        return false;
+
+    time_t second = nowUs / 1000000;
+    if (second != cachedSecond)
+    {
+        // Time zones are whole minutes, so inside a minute only tm_sec moves
+        if (cachedSecond && second > cachedSecond && second / 60 == cachedSecond / 60)
+            cachedLocal.tm_sec = second % 60;
+        else
+            localtime_r(&second, &cachedLocal);
+        cachedSecond = second;
+    }
+
+    out = cachedLocal;
+    return true;
+}
+
+uint32_t msUntilNextMinute(uint32_t fallback)
+{
+    int64_t nowUs = nowEpochUs();
+    if (nowUs == 0)
+        return fallback;
+
+    return 60000 - (nowUs / 1000) % 60000;
+}
+
+TimeStatus timeStatus()
+{
+    int64_t monoUs = esp_timer_get_time();
+
+    portENTER_CRITICAL(&timeLock);
+    TimeStatus status = {quality, syncCount,
+                         syncCount ? (uint32_t)((monoUs - lastSyncMonoUs) / 1000) : 0,
+                         (int32_t)driftPpb, lastOffsetMs, rejectedSyncs, floorOverrides};
+    portEXIT_CRITICAL(&timeLock);
+    return status;
+}
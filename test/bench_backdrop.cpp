@@ -0,0 +1,33 @@
+// Cost of the clock backdrop per cover on the host, over the area the
+// centered clock covers. The device logs the same from decodeCover().
+#include "test_main.h"
+#include "bench_main.h"
+#include <backdrop.h>
+#include <vector>
+
+#define SIZE 64
+
+int main()
+{
+    CHECK(backdropBegin(SIZE, SIZE));
+
+    std::vector<uint8_t> cover(SIZE * SIZE * 3), image(cover.size());
+    for (uint8_t &byte : cover)
+        byte = testRandom();
+
+    // The copy back is timed too; it is small next to the blur passes
+    const BackdropRegion regions[] = {{4, 22, 56, 20}, {0, 0, SIZE, SIZE}};
+    const char *names[] = {"backdrop clock", "backdrop full cover"};
+    for (int i = 0; i < 2; i++)
+    {
+        double nanos = benchNanos([&]
+                                  {
+                                      memcpy(image.data(), cover.data(), cover.size());
+                                      backdropApply(image.data(), regions[i]);
+                                  });
+        benchReport(names[i], nanos, SIZE * SIZE);
+    }
+    printf("passes %d, radius %d, feather %d\n", CLOCK_BACKDROP_PASSES, CLOCK_BACKDROP_BLUR_RADIUS,
+           CLOCK_BACKDROP_FEATHER);
+    return testResult();
+}
@@ -0,0 +1,45 @@
+// Host counterpart of the device self test (COLOR_TOOLS_SELFTEST): the same
+// kernels over the same buffer size. The SWAR variants are compiled for the
+// host by defining the S3 target macro, as in test_color_tools.cpp.
+#define CONFIG_IDF_TARGET_ESP32S3 1
+
+#include "test_main.h"
+#include "bench_main.h"
+#include <color_tools.h>
+#include <vector>
+
+#define BENCH_PIXELS 4096
+
+int main()
+{
+    std::vector<uint16_t> src(BENCH_PIXELS), out565(BENCH_PIXELS), scores(BENCH_PIXELS);
+    std::vector<uint8_t> out888(BENCH_PIXELS * 3);
+    for (uint16_t &pixel : src)
+        pixel = testRandom();
+
+    benchReport("rgb565->888", benchNanos([&] { rgb565ToRgb888BufferPortable(src.data(), out888.data(), BENCH_PIXELS); }), BENCH_PIXELS);
+    benchReport("rgb565->888 swar", benchNanos([&] { rgb565ToRgb888BufferSwar(src.data(), out888.data(), BENCH_PIXELS); }), BENCH_PIXELS);
+    benchReport("rgb888->565", benchNanos([&] { rgb888ToRgb565BufferPortable(out888.data(), out565.data(), BENCH_PIXELS); }), BENCH_PIXELS);
+    benchReport("brightness", benchNanos([&] { scaleBrightnessBufferPortable(src.data(), out565.data(), BENCH_PIXELS, 128); }), BENCH_PIXELS);
+    benchReport("brightness swar", benchNanos([&] { scaleBrightnessBufferSwar(src.data(), out565.data(), BENCH_PIXELS, 128); }), BENCH_PIXELS);
+    benchReport("vibrancy", benchNanos([&] { vibrancyBuffer(src.data(), scores.data(), BENCH_PIXELS); }), BENCH_PIXELS);
+
+    // Per pixel float scoring, what extractMostVibrantColor did before the batch kernel
+    std::vector<float> floatScores(BENCH_PIXELS);
+    benchReport("vibrancy float", benchNanos([&]
+                                             {
+                                                 for (int i = 0; i < BENCH_PIXELS; i++)
+                                                     floatScores[i] = calculateVibrancy(src[i]);
+                                             }),
+                BENCH_PIXELS);
+
+    uint32_t red[32] = {}, green[64] = {}, blue[32] = {};
+    benchReport("histogram", benchNanos([&] { channelHistogram(src.data(), BENCH_PIXELS, red, green, blue); }), BENCH_PIXELS);
+
+    // The kernels must agree while being timed, or the numbers compare different work
+    std::vector<uint8_t> swar888(BENCH_PIXELS * 3);
+    rgb565ToRgb888BufferPortable(src.data(), out888.data(), BENCH_PIXELS);
+    rgb565ToRgb888BufferSwar(src.data(), swar888.data(), BENCH_PIXELS);
+    CHECK(out888 == swar888);
+    return testResult();
+}
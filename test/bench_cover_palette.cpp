@@ -0,0 +1,109 @@
+// Host counterpart of the decode half of the cover self test
+// (COVER_INGEST_SELFTEST): what drawMCU and decodeCover do with the decoded
+// blocks of one cover, without JPEGDEC itself. The map of color counts grows
+// with the number of distinct colors, so the fixtures span a smooth gradient,
+// flat art and noise.
+#include "test_main.h"
+#include "bench_main.h"
+#include <cover_palette.h>
+#include <color_tools.h>
+#include <vector>
+
+#define COVER_SIZE 64
+#define MCU 8
+
+typedef std::vector<uint32_t> Fixture; // RGB8888 as JPEGDEC draws it
+
+static uint32_t rgba(int r, int g, int b)
+{
+    return std::min(255, std::max(0, r)) | std::min(255, std::max(0, g)) << 8 | std::min(255, std::max(0, b)) << 16 |
+           0xFF000000u;
+}
+
+static Fixture gradient()
+{
+    Fixture pixels(COVER_SIZE * COVER_SIZE);
+    for (int y = 0; y < COVER_SIZE; y++)
+        for (int x = 0; x < COVER_SIZE; x++)
+            pixels[y * COVER_SIZE + x] = rgba(x * 4, y * 4, 255 - x * 2 - y * 2);
+    return pixels;
+}
+
+// Flat shapes with soft noise and a few bright accents, like most album art
+static Fixture flatArt()
+{
+    Fixture pixels(COVER_SIZE * COVER_SIZE);
+    for (int y = 0; y < COVER_SIZE; y++)
+    {
+        for (int x = 0; x < COVER_SIZE; x++)
+        {
+            int noise = testRandom() % 7 - 3;
+            bool disc = (x - 40) * (x - 40) + (y - 24) * (y - 24) < 150;
+            bool band = y > 44 && y < 52;
+            int r = disc ? 230 : band ? 20 : 40;
+            int g = disc ? 180 : band ? 200 : 50;
+            int b = disc ? 40 : band ? 220 : 70;
+            pixels[y * COVER_SIZE + x] = rgba(r + noise, g + noise, b + noise);
+        }
+    }
+    return pixels;
+}
+
+static Fixture noise()
+{
+    Fixture pixels(COVER_SIZE * COVER_SIZE);
+    for (uint32_t &pixel : pixels)
+        pixel = testRandom() | 0xFF000000u;
+    return pixels;
+}
+
+// The cover as JPEGDEC hands it over: one MCU at a time
+static void storeCover(const Fixture &pixels, uint8_t *rgb, ColorCounts &counts)
+{
+    uint32_t block[MCU * MCU];
+    for (int y = 0; y < COVER_SIZE; y += MCU)
+    {
+        for (int x = 0; x < COVER_SIZE; x += MCU)
+        {
+            for (int row = 0; row < MCU; row++)
+                memcpy(block + row * MCU, &pixels[(y + row) * COVER_SIZE + x], MCU * sizeof(uint32_t));
+            coverPaletteStoreBlock(rgb, COVER_SIZE, COVER_SIZE, block, x, y, MCU, MCU, counts);
+        }
+    }
+}
+
+static void run(const char *name, const Fixture &pixels)
+{
+    std::vector<uint8_t> rgb(COVER_SIZE * COVER_SIZE * 3);
+    ColorCounts counts;
+    CoverPalette palette = {};
+
+    char label[40];
+    snprintf(label, sizeof(label), "store %s", name);
+    benchReport(label, benchNanos([&]
+                                  {
+                                      counts.clear();
+                                      storeCover(pixels, rgb.data(), counts);
+                                  }),
+                COVER_SIZE * COVER_SIZE);
+    snprintf(label, sizeof(label), "palette %s", name);
+    benchReport(label, benchNanos([&] { coverPaletteExtract(counts, palette); }), COVER_SIZE * COVER_SIZE);
+    printf("  %zu colors, primary %04x, secondary %04x\n", counts.size(), palette.primary, palette.secondary);
+
+    // Every pixel lands where it was decoded, and the clock colors differ
+    bool stored = true;
+    for (int i = 0; i < COVER_SIZE * COVER_SIZE; i++)
+        stored = stored && rgb[i * 3] == (pixels[i] & 0xFF) && rgb[i * 3 + 2] == ((pixels[i] >> 16) & 0xFF);
+    CHECK(stored);
+    CHECK(counts.count(palette.primary));
+    CHECK(!areColorsSimilar(palette.primary, palette.secondary, COLOR_SIMILARITY_THRESHOLD) ||
+          palette.secondary == invertColor(palette.primary));
+}
+
+int main()
+{
+    run("gradient", gradient());
+    run("flat art", flatArt());
+    run("noise", noise());
+    return testResult();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+
+// Minimal host benchmark harness: benchNanos repeats `kernel` for at least
+// BENCH_MIN_MS and returns the average time of one call
+#define BENCH_MIN_MS 200
+
+// Keeps the compiler from dropping or hoisting work whose result is unused
+static inline void benchClobber()
+{
+    asm volatile("" : : : "memory");
+}
+
+template <typename F>
+static double benchNanos(F kernel)
+{
+    typedef std::chrono::steady_clock Clock;
+    uint64_t calls = 0;
+    Clock::time_point start = Clock::now();
+    Clock::duration elapsed;
+    do
+    {
+        kernel();
+        benchClobber();
+        calls++;
+        elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(BENCH_MIN_MS));
+    return std::chrono::duration<double, std::nano>(elapsed).count() / calls;
+}
+
+// Prints "name: x us per call, y Mpx/s" for a kernel over `pixels` pixels
+static inline void benchReport(const char *name, double nanos, uint32_t pixels)
+{
+    printf("%-28s %10.2f us  %8.1f Mpx/s\n", name, nanos / 1000, pixels * 1000.0 / nanos);
+}
@@ -0,0 +1,159 @@
+// Quality and cost of the ways a cover can reach the panel's bit depth:
+// plain rounding, the ordered dither (averaged over its 16 phases, as the
+// eye does with DITHER_TEMPORAL) and error diffusion. Quality is the error
+// of the light the eye integrates over a 3x3 patch, and on a smooth ramp the
+// longest run of one output level, which is what banding looks like.
+#include "test_main.h"
+#include "bench_main.h"
+#include <panel_color.h>
+#include <vector>
+
+#define SIZE 64
+#define PIXELS (SIZE * SIZE)
+
+typedef std::vector<uint8_t> Image; // packed RGB888
+
+// Dark ramp: the shadows are where a few bits band the most
+static Image ramp()
+{
+    Image image(PIXELS * 3);
+    for (int y = 0; y < SIZE; y++)
+        for (int x = 0; x < SIZE; x++)
+            for (int c = 0; c < 3; c++)
+                image[(y * SIZE + x) * 3 + c] = x * 96 / SIZE + c * 8;
+    return image;
+}
+
+// Soft vignette over flat shapes with a little grain, like most album art
+static Image cover()
+{
+    Image image(PIXELS * 3);
+    for (int y = 0; y < SIZE; y++)
+    {
+        for (int x = 0; x < SIZE; x++)
+        {
+            int dx = x - SIZE / 2, dy = y - SIZE / 2;
+            int shade = 255 - (dx * dx + dy * dy) / 8;
+            bool shape = x > 16 && x < 40 && y > 20 && y < 48;
+            int grain = testRandom() % 5 - 2;
+            uint8_t *p = &image[(y * SIZE + x) * 3];
+            p[0] = std::max(0, std::min(255, (shape ? 200 : 60) * shade / 255 + grain));
+            p[1] = std::max(0, std::min(255, (shape ? 90 : 40) * shade / 255 + grain));
+            p[2] = std::max(0, std::min(255, (shape ? 30 : 110) * shade / 255 + grain));
+        }
+    }
+    return image;
+}
+
+static void roundToLevels(const uint8_t *src, uint8_t *dst)
+{
+    for (int i = 0; i < PIXELS * 3; i++)
+        dst[i] = panelLevelToByte(panelQuantize(panelGammaLut[i % 3][src[i]]));
+}
+
+// Linear light shown for each channel, averaged over `frames` outputs
+static std::vector<double> shown(const std::vector<Image> &frames)
+{
+    std::vector<double> light(PIXELS * 3, 0);
+    for (const Image &frame : frames)
+        for (int i = 0; i < PIXELS * 3; i++)
+            light[i] += panelLevelLinear[frame[i] >> (8 - PANEL_COLOR_DEPTH_BITS)] / (double)frames.size();
+    return light;
+}
+
+// Mean error of the 3x3 average, in 1/1000 of full scale
+static double patchError(const Image &src, const std::vector<double> &light)
+{
+    double total = 0;
+    int count = 0;
+    for (int y = 1; y < SIZE - 1; y++)
+    {
+        for (int x = 1; x < SIZE - 1; x++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                double error = 0;
+                for (int j = -1; j <= 1; j++)
+                {
+                    for (int i = -1; i <= 1; i++)
+                    {
+                        int k = ((y + j) * SIZE + x + i) * 3 + c;
+                        error += light[k] - panelGammaLut[c][src[k]];
+                    }
+                }
+                total += std::fabs(error / 9);
+                count++;
+            }
+        }
+    }
+    return total / count / 65.535;
+}
+
+// Longest run of one output level along the ramp's rows, green channel
+static int longestBand(const std::vector<double> &light)
+{
+    int longest = 0;
+    for (int y = 0; y < SIZE; y++)
+    {
+        int run = 1;
+        for (int x = 1; x < SIZE; x++)
+        {
+            int k = (y * SIZE + x) * 3 + 1;
+            run = light[k] == light[k - 3] ? run + 1 : 1;
+            longest = std::max(longest, run);
+        }
+    }
+    return longest;
+}
+
+struct Result
+{
+    double error;
+    int band;
+};
+
+static Result report(const char *name, const Image &src, const std::vector<Image> &frames, double nanos)
+{
+    std::vector<double> light = shown(frames);
+    Result result = {patchError(src, light), longestBand(light)};
+    printf("%-28s %10.2f us  %8.1f Mpx/s  error %6.3f/1000  longest band %2d px\n", name, nanos / 1000,
+           PIXELS * 1000.0 / nanos, result.error, result.band);
+    return result;
+}
+
+int main()
+{
+    PanelCalibration defaults = PANEL_CALIBRATION_DEFAULT;
+    panelColorBegin(defaults);
+    printf("%d bits per channel\n", PANEL_COLOR_DEPTH_BITS);
+
+    const char *names[] = {"ramp", "cover"};
+    Image fixtures[] = {ramp(), cover()};
+    for (int f = 0; f < 2; f++)
+    {
+        const Image &src = fixtures[f];
+        std::vector<Image> out(1, Image(PIXELS * 3));
+        char label[40];
+
+        snprintf(label, sizeof(label), "round %s", names[f]);
+        double nanos = benchNanos([&] { roundToLevels(src.data(), out[0].data()); });
+        Result rounded = report(label, src, out, nanos);
+
+        std::vector<Image> phases(16, Image(PIXELS * 3));
+        snprintf(label, sizeof(label), "ordered x16 %s", names[f]);
+        nanos = benchNanos([&] { ditherOrdered(src.data(), phases[0].data(), SIZE, SIZE, 0); });
+        for (uint32_t frame = 0; frame < 16; frame++)
+            ditherOrdered(src.data(), phases[frame].data(), SIZE, SIZE, frame);
+        Result ordered = report(label, src, phases, nanos);
+
+        snprintf(label, sizeof(label), "error diffusion %s", names[f]);
+        nanos = benchNanos([&] { ditherErrorDiffusion(src.data(), out[0].data(), SIZE, SIZE); });
+        Result diffused = report(label, src, out, nanos);
+
+        // Dithering must not be worse than rounding, or the time buys nothing
+        CHECK(diffused.error <= rounded.error);
+        CHECK(ordered.error <= rounded.error);
+        CHECK(diffused.band <= rounded.band);
+    }
+    return testResult();
+}
@@ -0,0 +1,331 @@
+#include "test_main.h"
+#include <jpeg_header.h>
+#include <cover_palette.h>
+#include <string.h>
+#include <vector>
+#ifdef FUZZ_JPEGDEC
+#include <cover_ingest.h>
+#endif
+
+// Fuzz target for the cover path, from the bytes a server sends to the clock
+// colors: the header check, the decode, drawMCU's clipping of every block
+// into the cover buffer and the palette extraction. Built two ways:
+//   - with -DLIBFUZZER and clang's -fsanitize=fuzzer for coverage-guided runs
+//   - otherwise with the driver below, which ctest runs: mutations of a few
+//     seed headers, or the files given on the command line (to replay a
+//     crash libFuzzer found)
+//
+// JPEGDEC comes from PlatformIO, so by default a stand-in decoder hands
+// out the blocks: MCUs of 8 or 16 pixels, batched along the row, rounded up
+// past the image edge and shifted by an origin the input picks, which covers
+// every placement drawMCU has to clip. With -DJPEGDEC_DIR the real library
+// decodes through coverIngestDecodeBuffer() instead.
+
+#define COVER_SIZE 64 // PANEL_WIDTH x PANEL_HEIGHT
+
+static uint8_t *cover; // exactly sized, so AddressSanitizer catches a store past it
+static ColorCounts counts;
+static uint32_t palettesExtracted;
+
+#ifdef FUZZ_JPEGDEC
+
+static int drawBlock(JPEGDRAW *draw)
+{
+    coverPaletteStoreBlock(cover, COVER_SIZE, COVER_SIZE, (const uint32_t *)draw->pPixels, draw->x, draw->y,
+                           draw->iWidth, draw->iHeight, counts);
+    return 1;
+}
+
+static CoverIngestResult decode(uint8_t *input, size_t size, JpegFrameInfo &)
+{
+    return coverIngestDecodeBuffer(input, size, drawBlock);
+}
+
+#else
+
+// Pixels covered on the cover, to check the clipping against
+static uint32_t expectedPixels;
+
+static CoverIngestResult decode(uint8_t *input, size_t size, JpegFrameInfo &info)
+{
+    CoverIngestResult result = jpegReadFrameInfo(input, size, info);
+    if (result != COVER_OK)
+        return result;
+
+    // The tail of the input picks the layout, the whole of it the pixels
+    uint8_t layout = input[size - 1];
+    int mcu = info.components == 3 && (layout & 1) ? 16 : 8;
+    int batch = 1 + (layout >> 1) % 8;
+    int originX = size > 1 ? (int8_t)input[size - 2] : 0;
+    int originY = size > 2 ? (int8_t)input[size - 3] : 0;
+
+    int blockWidth = mcu * batch;
+    int roundedWidth = (info.width + mcu - 1) / mcu * mcu;
+    int roundedHeight = (info.height + mcu - 1) / mcu * mcu;
+    std::vector<uint32_t> pixels(blockWidth * mcu);
+    size_t next = 0;
+    for (int y = 0; y < roundedHeight; y += mcu)
+    {
+        for (int x = 0; x < roundedWidth; x += blockWidth)
+        {
+            // Blocks that miss the cover still go through the clipping, but
+            // only the ones that land get fresh pixels, so big images stay fast
+            int width = std::min(blockWidth, roundedWidth - x);
+            bool lands = originX + x < COVER_SIZE && originX + x + width > 0 && originY + y < COVER_SIZE &&
+                         originY + y + mcu > 0;
+            for (int i = 0; lands && i < width * mcu; i++, next++)
+                pixels[i] = input[next % size] | input[(next * 7 + 1) % size] << 8 | input[(next * 13 + 2) % size] << 16;
+            coverPaletteStoreBlock(cover, COVER_SIZE, COVER_SIZE, pixels.data(), originX + x, originY + y, width, mcu,
+                                   counts);
+        }
+    }
+
+    int coveredX = std::max(0, std::min(COVER_SIZE, originX + roundedWidth) - std::max(0, originX));
+    int coveredY = std::max(0, std::min(COVER_SIZE, originY + roundedHeight) - std::max(0, originY));
+    expectedPixels = coveredX * coveredY;
+    return COVER_OK;
+}
+
+#endif
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (!cover)
+        cover = new uint8_t[COVER_SIZE * COVER_SIZE * 3];
+
+    // Exactly sized copy, so AddressSanitizer catches a read past the end
+    uint8_t *input = new uint8_t[size ? size : 1];
+    if (size)
+        memcpy(input, data, size);
+
+    JpegFrameInfo info = {};
+    counts.clear();
+    CoverIngestResult result = decode(input, size, info);
+    delete[] input;
+
+    // Only the decoder may fail past the header check
+    if (result != COVER_OK && result != COVER_MALFORMED && result != COVER_UNSUPPORTED &&
+        result != COVER_TOO_MANY_PIXELS && result != COVER_DECODE_FAILED)
+        abort();
+#ifndef FUZZ_JPEGDEC
+    if (result == COVER_DECODE_FAILED)
+        abort();
+    if (result == COVER_OK &&
+        (info.width == 0 || info.height == 0 || info.width > COVER_MAX_DIMENSION ||
+         info.height > COVER_MAX_DIMENSION || (info.components != 1 && info.components != 3)))
+        abort();
+#endif
+    if (result != COVER_OK)
+        return 0;
+
+    // Every stored pixel is counted once, and never more than the cover holds
+    uint32_t counted = 0;
+    for (const auto &entry : counts)
+        counted += entry.second;
+    if (counted > COVER_SIZE * COVER_SIZE)
+        abort();
+#ifndef FUZZ_JPEGDEC
+    if (counted != expectedPixels)
+        abort();
+#endif
+
+    CoverPalette palette;
+    if (coverPaletteExtract(counts, palette) != !counts.empty())
+        abort();
+    if (!counts.empty() && (!counts.count(palette.primary) || !counts.count(palette.mostCommon) ||
+                            !counts.count(palette.leastCommon)))
+        abort();
+    palettesExtracted += !counts.empty();
+    return 0;
+}
+
+#ifndef LIBFUZZER
+
+#define FUZZ_ITERATIONS 300000
+
+typedef std::vector<uint8_t> Bytes;
+
+static void append(Bytes &out, std::initializer_list<uint8_t> bytes)
+{
+    out.insert(out.end(), bytes);
+}
+
+static void appendSegment(Bytes &out, uint8_t marker, const Bytes &body)
+{
+    size_t length = body.size() + 2;
+    append(out, {0xFF, marker, (uint8_t)(length >> 8), (uint8_t)length});
+    out.insert(out.end(), body.begin(), body.end());
+}
+
+// Header of a cover as the firmware sees them: JFIF, tables, frame header
+// and the start of the scan. Only the part up to the frame header is parsed.
+static Bytes makeJpeg(uint8_t sof, uint16_t width, uint16_t height, uint8_t components, uint8_t lumaSampling)
+{
+    Bytes out;
+    append(out, {0xFF, 0xD8});
+    appendSegment(out, 0xE0, {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0});
+
+    Bytes table(65, 1);
+    table[0] = 0; // 8-bit, table 0
+    appendSegment(out, 0xDB, table);
+    table[0] = 1;
+    appendSegment(out, 0xDB, table);
+
+    append(out, {0xFF, 0xFF}); // fill byte before a marker
+
+    Bytes frame = {8, (uint8_t)(height >> 8), (uint8_t)height, (uint8_t)(width >> 8), (uint8_t)width, components};
+    for (uint8_t i = 0; i < components; i++)
+        frame.insert(frame.end(), {(uint8_t)(i + 1), i == 0 ? lumaSampling : (uint8_t)0x11, (uint8_t)(i ? 1 : 0)});
+    appendSegment(out, sof, frame);
+
+    Bytes huffman(17, 0);
+    huffman[1] = 1;
+    huffman.push_back(0);
+    appendSegment(out, 0xC4, huffman);
+
+    appendSegment(out, 0xDA, {1, 1, 0x00, 0, 63, 0});
+    append(out, {0x12, 0x34, 0xFF, 0x00, 0x56, 0xFF, 0xD9});
+    return out;
+}
+
+static CoverIngestResult parse(const Bytes &bytes, JpegFrameInfo &info)
+{
+    return jpegReadFrameInfo(bytes.data(), bytes.size(), info);
+}
+
+static void checkSeeds(const std::vector<Bytes> &seeds)
+{
+    JpegFrameInfo info;
+    CHECK(parse(seeds[0], info) == COVER_OK);
+    CHECK(info.width == 640 && info.height == 640 && info.components == 3 && !info.progressive);
+    CHECK(parse(seeds[1], info) == COVER_OK);
+    CHECK(info.width == 300 && info.height == 64 && info.components == 1 && info.progressive);
+    CHECK(parse(seeds[2], info) == COVER_TOO_MANY_PIXELS);
+    CHECK(parse(seeds[3], info) == COVER_UNSUPPORTED);
+    CHECK(parse(seeds[4], info) == COVER_UNSUPPORTED);
+
+    // Every cut before the end of the frame header is malformed, never a crash
+    size_t frameEnd = 0;
+    for (size_t i = 0; i + 1 < seeds[0].size(); i++)
+    {
+        if (seeds[0][i] == 0xFF && seeds[0][i + 1] == 0xC0)
+        {
+            frameEnd = i + 2 + ((seeds[0][i + 2] << 8) | seeds[0][i + 3]);
+            break;
+        }
+    }
+    CHECK(frameEnd > 0);
+    for (size_t length = 0; length < frameEnd; length++)
+    {
+        Bytes cut(seeds[0].begin(), seeds[0].begin() + length);
+        CHECK(parse(cut, info) == COVER_MALFORMED);
+    }
+}
+
+// One of the mutations libFuzzer would try, biased towards marker bytes and
+// segment lengths since those drive the walk
+static void mutate(Bytes &bytes, const std::vector<Bytes> &seeds)
+{
+    size_t at = bytes.empty() ? 0 : testRandom() % bytes.size();
+    switch (testRandom() % 8)
+    {
+    case 0:
+        if (!bytes.empty())
+            bytes[at] = testRandom();
+        break;
+    case 1:
+        if (!bytes.empty())
+            bytes[at] = testRandom() % 2 ? 0xFF : 0xC0 + testRandom() % 0x20;
+        break;
+    case 2:
+        // A big-endian length field, often right at a boundary
+        if (bytes.size() >= 2)
+        {
+            at = std::min(at, bytes.size() - 2);
+            uint16_t length = testRandom() % 2 ? bytes.size() - at + testRandom() % 5 - 2 : testRandom();
+            bytes[at] = length >> 8;
+            bytes[at + 1] = length;
+        }
+        break;
+    case 3:
+        bytes.insert(bytes.begin() + at, 1 + testRandom() % 4, 0xFF);
+        break;
+    case 4:
+        if (!bytes.empty())
+            bytes.erase(bytes.begin() + at, bytes.begin() + std::min(bytes.size(), at + 1 + testRandom() % 16));
+        break;
+    case 5:
+        bytes.resize(at);
+        break;
+    case 6:
+    {
+        // Splice the tail of another seed
+        const Bytes &other = seeds[testRandom() % seeds.size()];
+        size_t from = testRandom() % other.size();
+        bytes.resize(at);
+        bytes.insert(bytes.end(), other.begin() + from, other.end());
+        break;
+    }
+    default:
+        for (int i = testRandom() % 32; i > 0; i--)
+            bytes.insert(bytes.begin() + at, (uint8_t)testRandom());
+        break;
+    }
+}
+
+static int replayFiles(int count, char **paths)
+{
+    for (int i = 0; i < count; i++)
+    {
+        FILE *file = fopen(paths[i], "rb");
+        if (!file)
+        {
+            fprintf(stderr, "cannot open %s\n", paths[i]);
+            return EXIT_FAILURE;
+        }
+        Bytes bytes;
+        int c;
+        while ((c = fgetc(file)) != EOF)
+            bytes.push_back(c);
+        fclose(file);
+        LLVMFuzzerTestOneInput(bytes.data(), bytes.size());
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+        return replayFiles(argc - 1, argv + 1);
+
+    std::vector<Bytes> seeds = {
+        makeJpeg(0xC0, 640, 640, 3, 0x22),
+        makeJpeg(0xC2, 300, 64, 1, 0x11),
+        makeJpeg(0xC0, 3000, 3000, 3, 0x22),
+        makeJpeg(0xC3, 64, 64, 3, 0x11),
+        makeJpeg(0xC1, 64, 64, 3, 0x41),
+    };
+    checkSeeds(seeds);
+
+    uint32_t results[COVER_RESULT_COUNT] = {};
+    for (int i = 0; i < FUZZ_ITERATIONS; i++)
+    {
+        Bytes input = seeds[testRandom() % seeds.size()];
+        for (int m = 1 + testRandom() % 4; m > 0; m--)
+            mutate(input, seeds);
+
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        JpegFrameInfo info;
+        results[parse(input, info)]++;
+    }
+
+    // The mutations must still reach every outcome, or they stopped exercising the parser
+    CHECK(results[COVER_OK] > 0);
+    CHECK(results[COVER_MALFORMED] > 0);
+    CHECK(results[COVER_UNSUPPORTED] > 0);
+    CHECK(results[COVER_TOO_MANY_PIXELS] > 0);
+    CHECK(palettesExtracted > 0);
+    return testResult();
+}
+
+#endif
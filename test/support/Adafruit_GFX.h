@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Just enough of Adafruit_GFX for marquee.cpp. drawChar() paints a 5x7 cell
+// with a pattern taken from the character code instead of the classic font,
+// which the host tests have no use for.
+class Adafruit_GFX
+{
+public:
+    Adafruit_GFX(int16_t w, int16_t h) : w(w), h(h) {}
+    virtual ~Adafruit_GFX() {}
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+    int16_t width() const { return w; }
+    int16_t height() const { return h; }
+    void cp437(bool) {}
+
+    void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t, uint8_t)
+    {
+        if (c == ' ')
+            return;
+        for (int16_t col = 0; col < 5; col++)
+        {
+            for (int16_t row = 0; row < 7; row++)
+            {
+                if ((c >> ((col + row) & 7)) & 1)
+                    drawPixel(x + col, y + row, color);
+            }
+        }
+    }
+
+private:
+    int16_t w;
+    int16_t h;
+};
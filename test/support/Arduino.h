@@ -0,0 +1,63 @@
+#pragma once
+
+// Just enough of the Arduino API for the hardware-independent sources that
+// the host tests compile
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+static inline uint32_t micros()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static inline uint32_t millis()
+{
+    return micros() / 1000;
+}
+
+// PSRAM is plain heap on the host
+#define MALLOC_CAP_SPIRAM 0
+
+static inline void *heap_caps_malloc(size_t size, uint32_t)
+{
+    return malloc(size);
+}
+
+static inline void *heap_caps_calloc(size_t count, size_t size, uint32_t)
+{
+    return calloc(count, size);
+}
+
+static inline void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+// Each host thread stands in for a FreeRTOS task
+typedef void *TaskHandle_t;
+
+static inline TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    static thread_local char self;
+    return &self;
+}
+
+#if !defined(__GLIBC__) || __GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38)
+static inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t length = strlen(src);
+    if (size)
+    {
+        size_t n = std::min(length, size - 1);
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return length;
+}
+#endif
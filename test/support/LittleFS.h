@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Just enough of LittleFS for cover_ingest.cpp. The host has no filesystem,
+// so nothing opens; the host targets only decode buffers.
+class File
+{
+public:
+    explicit operator bool() const { return false; }
+    size_t size() { return 0; }
+    size_t read(uint8_t *, size_t) { return 0; }
+    void close() {}
+};
+
+struct LittleFSHost
+{
+    File open(const char *, const char *) { return File(); }
+};
+
+static LittleFSHost LittleFS;
@@ -0,0 +1,4 @@
+#pragma once
+
+// Host builds use the template configuration
+#include "../../include/config.example.h"
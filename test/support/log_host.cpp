@@ -0,0 +1,24 @@
+#include <log.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+// Host side of log.h: records go straight to stderr
+
+void logWrite(uint8_t level, const char *fmt, ...)
+{
+    static const char levels[] = "?EWID";
+    fprintf(stderr, "[%c] ", levels[level < 5 ? level : 0]);
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+void logEnqueueDeferred(uint8_t level, const char *fmt, const uint32_t *args, uint8_t count)
+{
+    uint32_t a[LOG_MAX_ARGS] = {};
+    for (uint8_t i = 0; i < count && i < LOG_MAX_ARGS; i++)
+        a[i] = args[i];
+    logWrite(level, fmt, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
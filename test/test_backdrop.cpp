@@ -0,0 +1,157 @@
+#include "test_main.h"
+#include <backdrop.h>
+#include <vector>
+
+#define SIZE 64
+
+typedef std::vector<uint8_t> Image; // packed RGB888
+
+static const BackdropRegion clockRegion = {4, 22, 56, 20}; // about where the centered clock lands
+
+static Image flat(uint8_t r, uint8_t g, uint8_t b)
+{
+    Image image(SIZE * SIZE * 3);
+    for (int i = 0; i < SIZE * SIZE; i++)
+    {
+        image[i * 3 + 0] = r;
+        image[i * 3 + 1] = g;
+        image[i * 3 + 2] = b;
+    }
+    return image;
+}
+
+static Image noise()
+{
+    Image image(SIZE * SIZE * 3);
+    for (uint8_t &byte : image)
+        byte = testRandom();
+    return image;
+}
+
+static const uint8_t *at(const Image &image, int x, int y)
+{
+    return &image[(y * SIZE + x) * 3];
+}
+
+static bool inside(const BackdropRegion &region, int grow, int x, int y)
+{
+    return x >= region.x - grow && x < region.x + region.w + grow && y >= region.y - grow &&
+           y < region.y + region.h + grow;
+}
+
+// Flat art only shows the dimming: exactly CLOCK_BACKDROP_DIM over the text
+// and margin, fading back to the original monotonically over the feather
+static void testDimAndFeather()
+{
+    const uint8_t color[3] = {200, 120, 80};
+    Image image = flat(color[0], color[1], color[2]);
+    backdropApply(image.data(), clockRegion);
+
+    for (int y = 0; y < SIZE; y++)
+    {
+        for (int x = 0; x < SIZE; x++)
+        {
+            const uint8_t *p = at(image, x, y);
+            for (int c = 0; c < 3; c++)
+            {
+                if (inside(clockRegion, CLOCK_BACKDROP_MARGIN, x, y))
+                    CHECK(p[c] == (color[c] * CLOCK_BACKDROP_DIM) >> 8);
+                else if (!inside(clockRegion, CLOCK_BACKDROP_MARGIN + CLOCK_BACKDROP_FEATHER, x, y))
+                    CHECK(p[c] == color[c]);
+            }
+        }
+    }
+
+    // Walking away from the text never gets darker, in any direction
+    int x0 = clockRegion.x - CLOCK_BACKDROP_MARGIN, x1 = clockRegion.x + clockRegion.w + CLOCK_BACKDROP_MARGIN;
+    int y0 = clockRegion.y - CLOCK_BACKDROP_MARGIN, y1 = clockRegion.y + clockRegion.h + CLOCK_BACKDROP_MARGIN;
+    for (int y = 0; y < SIZE; y++)
+    {
+        for (int x = 1; x < SIZE; x++)
+        {
+            if (x <= x0)
+                CHECK(at(image, x - 1, y)[0] >= at(image, x, y)[0]);
+            if (x >= x1)
+                CHECK(at(image, x, y)[0] >= at(image, x - 1, y)[0]);
+        }
+    }
+    for (int x = 0; x < SIZE; x++)
+    {
+        for (int y = 1; y < SIZE; y++)
+        {
+            if (y <= y0)
+                CHECK(at(image, x, y - 1)[0] >= at(image, x, y)[0]);
+            if (y >= y1)
+                CHECK(at(image, x, y)[0] >= at(image, x, y - 1)[0]);
+        }
+    }
+}
+
+static double variance(const Image &image, const BackdropRegion &region)
+{
+    double sum = 0, squares = 0;
+    int count = 0;
+    for (int y = region.y; y < region.y + region.h; y++)
+    {
+        for (int x = region.x; x < region.x + region.w; x++)
+        {
+            double v = at(image, x, y)[1];
+            sum += v;
+            squares += v * v;
+            count++;
+        }
+    }
+    double mean = sum / count;
+    return squares / count - mean * mean;
+}
+
+// Noise shows the blur: far smoother under the text, untouched outside
+static void testBlur()
+{
+    Image before = noise();
+    Image image = before;
+    backdropApply(image.data(), clockRegion);
+
+    double dim = CLOCK_BACKDROP_DIM / 256.0;
+    CHECK(variance(image, clockRegion) < variance(before, clockRegion) * dim * dim / 4);
+
+    bool untouched = true;
+    for (int y = 0; y < SIZE; y++)
+        for (int x = 0; x < SIZE; x++)
+            if (!inside(clockRegion, CLOCK_BACKDROP_MARGIN + CLOCK_BACKDROP_FEATHER, x, y))
+                untouched = untouched && memcmp(at(image, x, y), at(before, x, y), 3) == 0;
+    CHECK(untouched);
+}
+
+// Regions over or past the edges clip; AddressSanitizer watches the buffers
+static void testEdges()
+{
+    const BackdropRegion regions[] = {
+        {-10, -10, 20, 20}, {50, 50, 40, 40}, {0, 0, SIZE, SIZE}, {-5, 30, SIZE + 10, 4}, {30, 2, 0, 0},
+    };
+    for (const BackdropRegion &region : regions)
+    {
+        Image image = noise();
+        backdropApply(image.data(), region);
+    }
+
+    // Wholly outside, even the feather: nothing changes
+    Image before = noise();
+    Image image = before;
+    backdropApply(image.data(), {SIZE + 20, 0, 10, 10});
+    CHECK(image == before);
+}
+
+int main()
+{
+    // Nothing happens before the buffers exist
+    Image image = noise(), before = image;
+    CHECK(backdropApply(image.data(), clockRegion) == 0);
+    CHECK(image == before);
+
+    CHECK(backdropBegin(SIZE, SIZE));
+    testDimAndFeather();
+    testBlur();
+    testEdges();
+    return testResult();
+}
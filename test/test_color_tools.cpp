@@ -0,0 +1,54 @@
+// The SWAR kernels are pure C, so the host checks them too
+#define CONFIG_IDF_TARGET_ESP32S3 1
+
+#include "test_main.h"
+#include <color_tools.h>
+#include <vector>
+
+// Defined in test_color_tools_second_tu.cpp, which includes color_tools.h again
+uint16_t invertColorFromSecondUnit(uint16_t color);
+
+int main()
+{
+    // Batch conversions match the scalar helpers for every RGB565 value
+    std::vector<uint16_t> all(0x10000 + 1), back(0x10000 + 1);
+    std::vector<uint8_t> rgb(all.size() * 3), rgbSwar(all.size() * 3);
+    for (uint32_t i = 0; i < all.size(); i++)
+        all[i] = i;
+
+    rgb565ToRgb888BufferPortable(all.data(), rgb.data(), 0x10000);
+    for (uint32_t c = 0; c < 0x10000; c++)
+    {
+        uint8_t r, g, b;
+        rgb565ToRgb8(c, r, g, b);
+        CHECK(rgb[c * 3] == r && rgb[c * 3 + 1] == g && rgb[c * 3 + 2] == b);
+        CHECK(rgb8ToRgb565(r, g, b) == c);
+    }
+    rgb888ToRgb565BufferPortable(rgb.data(), back.data(), 0x10000);
+    CHECK(memcmp(back.data(), all.data(), 0x10000 * sizeof(uint16_t)) == 0);
+
+    // SWAR against portable at both alignments and odd lengths
+    for (int offset = 0; offset < 2; offset++)
+    {
+        size_t count = 0x10000 - offset - 1;
+        rgb565ToRgb888BufferPortable(all.data() + offset, rgb.data(), count);
+        rgb565ToRgb888BufferSwar(all.data() + offset, rgbSwar.data(), count);
+        CHECK(memcmp(rgb.data(), rgbSwar.data(), count * 3) == 0);
+
+        for (uint16_t scale : {0, 1, 77, 128, 255, 256})
+        {
+            std::vector<uint16_t> a(all.size()), b(all.size());
+            scaleBrightnessBufferPortable(all.data() + offset, a.data() + offset, count, scale);
+            scaleBrightnessBufferSwar(all.data() + offset, b.data() + offset, count, scale);
+            CHECK(a == b);
+        }
+    }
+
+    CHECK(invertColor(0x0000) == 0xFFFF);
+    CHECK(invertColorFromSecondUnit(0xFFFF) == 0x0000);
+    CHECK(areColorsSimilar(0xF800, 0xF800, 0));
+    CHECK(!areColorsSimilar(0xF800, 0x001F, 10));
+    CHECK(calculateVibrancy(0xF800) > calculateVibrancy(0x8410));
+
+    return testResult();
+}
@@ -0,0 +1,8 @@
+// A second translation unit including color_tools.h, as the firmware has;
+// the test fails to link if the header defines anything non-inline
+#include <color_tools.h>
+
+uint16_t invertColorFromSecondUnit(uint16_t color)
+{
+    return invertColor(color);
+}
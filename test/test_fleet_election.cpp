@@ -0,0 +1,264 @@
+#include "test_main.h"
+#include <fleet_election.h>
+#include <vector>
+
+// Several clocks on one virtual network. Each has its own millis(), some of
+// them about to wrap, and heartbeats start at different phases like real
+// boots. Clocks that are not following poll Spotify, and send while those
+// polls succeed, as in main.cpp's netTask and fleet.cpp's fleetTask. This
+// drives the rules fleet.cpp uses, not its sockets.
+
+#define STEP_MS 10
+#define POLL_MS 1000
+
+struct Node
+{
+    uint32_t id;
+    uint32_t clockOffset;
+    uint32_t nextHeartbeat; // virtual time
+    uint32_t nextPoll;      // virtual time
+    bool online;
+    bool spotifyOk; // whether its polls succeed
+    FleetElection election;
+};
+
+struct Network
+{
+    std::vector<Node> nodes;
+    uint32_t now = 0; // virtual time
+    uint32_t lossPercent = 0;
+
+    uint32_t millisOf(const Node &node) const
+    {
+        return now + node.clockOffset;
+    }
+
+    void add(uint32_t id, uint32_t clockOffset)
+    {
+        Node node = {id, clockOffset, 0, 0, false, true, {}};
+        nodes.push_back(node);
+        boot(id);
+    }
+
+    Node &node(uint32_t id)
+    {
+        for (Node &n : nodes)
+            if (n.id == id)
+                return n;
+        abort();
+    }
+
+    void boot(uint32_t id)
+    {
+        Node &n = node(id);
+        n.online = true;
+        n.spotifyOk = true;
+        n.nextHeartbeat = now + testRandom() % FLEET_HEARTBEAT_MS;
+        n.nextPoll = now + testRandom() % POLL_MS;
+        fleetElectionBegin(n.election, id);
+    }
+
+    bool leading(const Node &n) const
+    {
+        return n.online && !fleetElectionIsFollower(n.election, millisOf(n));
+    }
+
+    bool sending(const Node &n) const
+    {
+        return n.online && fleetElectionShouldSend(n.election, millisOf(n), POLL_MS);
+    }
+
+    void step()
+    {
+        now += STEP_MS;
+        for (Node &n : nodes)
+        {
+            if (!n.online || (int32_t)(now - n.nextPoll) < 0)
+                continue;
+            n.nextPoll += POLL_MS;
+            if (leading(n))
+                fleetElectionPolled(n.election, n.spotifyOk, millisOf(n));
+        }
+
+        for (Node &sender : nodes)
+        {
+            if (!sender.online || (int32_t)(now - sender.nextHeartbeat) < 0)
+                continue;
+            sender.nextHeartbeat += FLEET_HEARTBEAT_MS;
+            if (!sending(sender))
+                continue;
+
+            for (Node &receiver : nodes)
+            {
+                if (&receiver == &sender || !receiver.online || testRandom() % 100 < lossPercent)
+                    continue;
+                fleetElectionHeard(receiver.election, sender.id, millisOf(receiver));
+            }
+        }
+    }
+
+    void run(uint32_t ms)
+    {
+        for (uint32_t t = 0; t < ms; t += STEP_MS)
+            step();
+    }
+
+    // Id of the only clock that is sending its state, 0 if none or several
+    uint32_t soleLeader() const
+    {
+        uint32_t leader = 0;
+        int count = 0;
+        for (const Node &n : nodes)
+        {
+            if (sending(n))
+            {
+                leader = n.id;
+                count++;
+            }
+        }
+        return count == 1 ? leader : 0;
+    }
+
+    bool allFollow(uint32_t leader) const
+    {
+        for (const Node &n : nodes)
+        {
+            if (n.online && n.id != leader &&
+                !(fleetElectionIsFollower(n.election, millisOf(n)) && n.election.leaderId == leader))
+                return false;
+        }
+        return true;
+    }
+};
+
+// Longest a change of leader may take: the old one's silence must time out,
+// then every candidate gets one heartbeat to be heard and one to settle
+#define TAKEOVER_MS (FLEET_LEADER_TIMEOUT_MS + 2 * FLEET_HEARTBEAT_MS + STEP_MS)
+
+// Longest a clock that (re)starts leading takes to send: one poll, then its
+// heartbeat is heard and settles
+#define LEAD_MS (POLL_MS + 2 * FLEET_HEARTBEAT_MS + STEP_MS)
+
+static void testLowestIdLeads()
+{
+    Network net;
+    net.add(0x30, 0);
+    net.add(0x10, 0xFFFFF000u); // wraps a few seconds in
+    net.add(0x40, 12345);
+    net.add(0x20, 0x80000000u);
+
+    net.run(LEAD_MS);
+    CHECK(net.soleLeader() == 0x10);
+    CHECK(net.allFollow(0x10));
+
+    // Stays put, including across the clock wrap
+    bool stable = true;
+    for (int i = 0; i < 60000 / STEP_MS; i++)
+    {
+        net.step();
+        stable = stable && net.soleLeader() == 0x10 && net.allFollow(0x10);
+    }
+    CHECK(stable);
+}
+
+static void testTakeoverAndReturn()
+{
+    Network net;
+    net.add(0x10, 0);
+    net.add(0x20, 0xFFFFFF00u);
+    net.add(0x30, 777);
+    net.run(30000);
+    CHECK(net.soleLeader() == 0x10);
+
+    // Leader powers off: the next lowest takes over once it timed out
+    net.node(0x10).online = false;
+    net.run(FLEET_LEADER_TIMEOUT_MS - FLEET_HEARTBEAT_MS);
+    CHECK(net.soleLeader() == 0); // nobody polls while the old leader is presumed alive
+    net.run(TAKEOVER_MS + POLL_MS - (FLEET_LEADER_TIMEOUT_MS - FLEET_HEARTBEAT_MS));
+    CHECK(net.soleLeader() == 0x20);
+    CHECK(net.allFollow(0x20));
+
+    // It comes back with a fresh boot and takes the lead again right away
+    net.boot(0x10);
+    net.run(LEAD_MS);
+    CHECK(net.soleLeader() == 0x10);
+    CHECK(net.allFollow(0x10));
+}
+
+static void testFailingPolls()
+{
+    Network net;
+    net.add(0x10, 0);
+    net.add(0x20, 0x7FFFFF00u);
+    net.add(0x30, 4242);
+    net.run(30000);
+    CHECK(net.soleLeader() == 0x10);
+
+    // Leader stays online but Spotify stops answering it (expired session,
+    // rate limit): it keeps the last good state for a few polls, then goes
+    // quiet while still polling, and the next clock takes over
+    net.node(0x10).spotifyOk = false;
+    net.run((FLEET_QUIET_AFTER_FAILED_POLLS - 1) * POLL_MS);
+    CHECK(net.soleLeader() == 0x10);
+    net.run(POLL_MS + STEP_MS);
+    CHECK(!net.sending(net.node(0x10)));
+    CHECK(net.leading(net.node(0x10)));
+    net.run(TAKEOVER_MS + POLL_MS);
+    CHECK(net.soleLeader() == 0x20);
+    CHECK(net.node(0x30).election.leaderId == 0x20);
+    CHECK(fleetElectionIsFollower(net.node(0x30).election, net.millisOf(net.node(0x30))));
+
+    // A second one failing hands over to the last
+    net.node(0x20).spotifyOk = false;
+    net.run(FLEET_QUIET_AFTER_FAILED_POLLS * POLL_MS + TAKEOVER_MS + POLL_MS);
+    CHECK(net.soleLeader() == 0x30);
+
+    // Polls recover: a lower id never follows, so it leads after one good poll
+    net.node(0x10).spotifyOk = true;
+    net.node(0x20).spotifyOk = true;
+    net.run(LEAD_MS);
+    CHECK(net.soleLeader() == 0x10);
+    CHECK(net.allFollow(0x10));
+
+    // Nobody reaches Spotify: nobody sends stale state
+    for (Node &n : net.nodes)
+        n.spotifyOk = false;
+    net.run(FLEET_QUIET_AFTER_FAILED_POLLS * POLL_MS + TAKEOVER_MS + POLL_MS);
+    CHECK(net.soleLeader() == 0);
+    for (const Node &n : net.nodes)
+        CHECK(!net.sending(n));
+}
+
+static void testPacketLoss()
+{
+    Network net;
+    for (uint32_t id = 1; id <= 6; id++)
+        net.add(id * 0x100, testRandom());
+    net.lossPercent = 20;
+
+    // Losing several heartbeats in a row makes a follower poll for a moment,
+    // but the lowest id must keep leading and the fleet must settle back
+    // quickly enough that one clock polls nearly all of the time
+    net.run(10000);
+    uint32_t steps = 0;
+    uint32_t settled = 0;
+    bool lowestLeads = true;
+    for (int i = 0; i < 600000 / STEP_MS; i++)
+    {
+        net.step();
+        steps++;
+        settled += net.soleLeader() == 0x100;
+        lowestLeads = lowestLeads && net.leading(net.node(0x100));
+    }
+    CHECK(lowestLeads);
+    CHECK(settled * 100 >= steps * 97);
+}
+
+int main()
+{
+    testLowestIdLeads();
+    testTakeoverAndReturn();
+    testFailingPolls();
+    testPacketLoss();
+    return testResult();
+}
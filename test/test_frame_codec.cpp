@@ -0,0 +1,79 @@
+#include "test_main.h"
+#include <frame_codec.h>
+#include <vector>
+
+#define WIDTH 64
+#define HEIGHT 64
+#define PIXELS (WIDTH * HEIGHT)
+#define FRAMES 20000
+
+// Next frame from the previous one: mostly small edits like a moving clock
+// or marquee, sometimes a full new cover, sometimes nothing
+static void mutateFrame(std::vector<uint16_t> &frame)
+{
+    switch (testRandom() % 8)
+    {
+    case 0:
+        for (uint16_t &pixel : frame)
+            pixel = testRandom();
+        break;
+    case 1:
+        break;
+    default:
+    {
+        int edits = 1 + testRandom() % 300;
+        for (int e = 0; e < edits; e++)
+        {
+            // Short spans, so runs of both kinds and lone unchanged pixels occur
+            size_t start = testRandom() % PIXELS;
+            size_t span = 1 + testRandom() % 12;
+            for (size_t i = start; i < std::min<size_t>(start + span, PIXELS); i++)
+                frame[i] = testRandom() % 4 ? testRandom() : 0;
+        }
+        break;
+    }
+    }
+}
+
+int main()
+{
+    std::vector<uint16_t> frame(PIXELS, 0), reference(PIXELS, 0), client(PIXELS, 0);
+    std::vector<uint8_t> message(frameCodecMaxBytes(PIXELS));
+    uint32_t mismatches = 0;
+
+    for (uint32_t sequence = 1; sequence <= FRAMES; sequence++)
+    {
+        mutateFrame(frame);
+        bool keyframe = sequence == 1 || testRandom() % 50 == 0;
+
+        size_t length = encodeFrame(frame.data(), keyframe ? nullptr : reference.data(),
+                                    WIDTH, HEIGHT, sequence, message.data(), message.size());
+        CHECK(length >= FRAME_CODEC_HEADER_BYTES);
+
+        uint32_t decodedSequence = 0;
+        CHECK(decodeFrame(message.data(), length, client.data(), WIDTH, HEIGHT, &decodedSequence));
+        CHECK(decodedSequence == sequence);
+        if (client != frame)
+            mismatches++;
+
+        reference = frame;
+    }
+    CHECK(mismatches == 0);
+
+    // Worst case: every pixel changes with a zero between them
+    for (size_t i = 0; i < PIXELS; i++)
+        frame[i] = i & 1 ? 0 : 0xFFFF;
+    size_t length = encodeFrame(frame.data(), nullptr, WIDTH, HEIGHT, 1, message.data(), message.size());
+    CHECK(length > 0 && length <= frameCodecMaxBytes(PIXELS));
+    CHECK(decodeFrame(message.data(), length, client.data(), WIDTH, HEIGHT, nullptr));
+    CHECK(client == frame);
+
+    // Too small a buffer is refused, not overrun
+    CHECK(encodeFrame(frame.data(), nullptr, WIDTH, HEIGHT, 1, message.data(), message.size() - 1) == 0);
+
+    // Truncated and mismatched messages are rejected
+    CHECK(!decodeFrame(message.data(), length - 1, client.data(), WIDTH, HEIGHT, nullptr));
+    CHECK(!decodeFrame(message.data(), length, client.data(), WIDTH, HEIGHT - 1, nullptr));
+
+    return testResult();
+}
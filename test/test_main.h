@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Minimal host test harness: CHECK records a failure and keeps going, the
+// test returns testResult() from main so ctest sees the outcome
+static int testFailures = 0;
+
+#define CHECK(condition)                                                          \
+    do                                                                            \
+    {                                                                             \
+        if (!(condition))                                                         \
+        {                                                                         \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            testFailures++;                                                       \
+        }                                                                         \
+    } while (0)
+
+static inline int testResult()
+{
+    if (testFailures)
+        fprintf(stderr, "%d check(s) failed\n", testFailures);
+    return testFailures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Deterministic xorshift32 so failures reproduce
+static uint32_t testRandomState = 0x12345678;
+
+static inline uint32_t testRandom()
+{
+    testRandomState ^= testRandomState << 13;
+    testRandomState ^= testRandomState >> 17;
+    testRandomState ^= testRandomState << 5;
+    return testRandomState;
+}
@@ -0,0 +1,86 @@
+#include "test_main.h"
+#include <panel_color.h>
+#include <color_channels.h>
+#include <cmath>
+
+template <typename T>
+static bool nonDecreasing(const T *table, int count)
+{
+    for (int i = 1; i < count; i++)
+    {
+        if (table[i] < table[i - 1])
+            return false;
+    }
+    return true;
+}
+
+// Brighter input must never show darker, black must stay black and full
+// input must reach the white balance gain exactly
+static void checkTables(const PanelCalibration &cal)
+{
+    for (int c = 0; c < 3; c++)
+    {
+        CHECK(nonDecreasing(panelGammaLut[c], 256));
+        CHECK(panelGammaLut[c][0] == 0);
+        CHECK(panelGammaLut[c][255] == lroundf(65535.0f * cal.white[c] / 256.0f));
+    }
+    CHECK(nonDecreasing(panelLevelLinear, PANEL_LEVELS + 1));
+    CHECK(panelLevelLinear[0] == 0 && panelLevelLinear[PANEL_LEVELS] == 65535);
+    CHECK(nonDecreasing(panelRed5, 32));
+    CHECK(nonDecreasing(panelGreen6, 64));
+    CHECK(nonDecreasing(panelBlue5, 32));
+    CHECK(panelRed5[0] == 0 && panelGreen6[0] == 0 && panelBlue5[0] == 0);
+}
+
+int main()
+{
+    // Every calibration the header and the NVS loader accept
+    static const uint16_t whites[] = {1, 2, 17, 64, 128, 200, 255, 256};
+    for (float gamma = PANEL_GAMMA_MIN; gamma <= PANEL_GAMMA_MAX + 0.001f; gamma += 0.05f)
+    {
+        for (uint16_t white : whites)
+        {
+            PanelCalibration cal = {{gamma, std::min(gamma + 0.3f, PANEL_GAMMA_MAX), PANEL_GAMMA_MAX + PANEL_GAMMA_MIN - gamma},
+                                    {white, (uint16_t)(257 - white), 256}};
+            panelColorBegin(cal);
+            checkTables(cal);
+        }
+    }
+
+    // The build defaults are the plain gamma curve on every channel
+    PanelCalibration defaults = PANEL_CALIBRATION_DEFAULT;
+    panelColorBegin(defaults);
+    checkTables(defaults);
+    for (int c = 0; c < 3; c++)
+    {
+        CHECK(panelCalibration().gamma[c] == PANEL_GAMMA && panelCalibration().white[c] == 256);
+        for (int i = 0; i < 256; i++)
+            CHECK(panelGammaLut[c][i] == lroundf(powf(i / 255.0f, PANEL_GAMMA) * 65535.0f));
+    }
+    for (int i = 0; i < 32; i++)
+        CHECK(panelRed5[i] == panelBlue5[i]);
+    CHECK(panelRed5[31] == panelLevelToByte(PANEL_LEVELS) && panelGreen6[63] == panelLevelToByte(PANEL_LEVELS));
+
+    // Dithering a flat gray keeps its average light within half a level
+    static uint8_t src[64 * 64 * 3], dst[64 * 64 * 3];
+    for (int gray = 0; gray < 256; gray += 5)
+    {
+        memset(src, gray, sizeof(src));
+        ditherErrorDiffusion(src, dst, 64, 64);
+        uint64_t total = 0;
+        for (size_t i = 0; i < sizeof(dst); i += 3)
+            total += panelLevelLinear[dst[i] >> (8 - PANEL_COLOR_DEPTH_BITS)];
+        int64_t average = total / (sizeof(dst) / 3);
+        CHECK(std::llabs(average - panelGammaLut[0][gray]) <= 65535 / PANEL_LEVELS / 2);
+    }
+
+    // Wider images are refused rather than read with the wrong stride
+    static uint8_t wide[(DITHER_MAX_WIDTH + 1) * 2 * 3];
+    memset(dst, 0xAA, sizeof(dst));
+    CHECK(!ditherErrorDiffusion(wide, dst, DITHER_MAX_WIDTH + 1, 2));
+    CHECK(!ditherErrorDiffusion(wide, dst, 0, 2));
+    CHECK(dst[0] == 0xAA && dst[sizeof(dst) - 1] == 0xAA);
+    CHECK(ditherErrorDiffusion(src, dst, DITHER_MAX_WIDTH, 64));
+
+    return testResult();
+}
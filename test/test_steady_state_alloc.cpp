@@ -0,0 +1,173 @@
+#include "test_main.h"
+#include <alloc_guard.h>
+#include <string_hash.h>
+#include <color_tools.h>
+#include <panel_color.h>
+#include <marquee.h>
+#include <new>
+#include <stdio.h>
+
+// The two guarded sections of main.cpp in their steady state (same track,
+// same cover, a scrolling title), under AllocGuard with malloc, calloc and
+// realloc wrapped at link time as in the debug environment. main.cpp needs
+// the panel driver and the Spotify client, so the frame is put together here
+// from the parts it draws with: the temporal dither of the cover, the clock
+// colors and the marquee. Any allocation in there fails the test.
+
+// On the device libstdc++ is linked in statically, so the wrap also sees the
+// malloc behind operator new. On the host it is a shared library, so new and
+// delete are sent through the wrapped malloc here.
+void *operator new(size_t size)
+{
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+#define WIDTH 64
+#define HEIGHT 64
+#define FRAMES 2000
+
+class FrameCanvas : public Adafruit_GFX
+{
+public:
+    FrameCanvas() : Adafruit_GFX(WIDTH, HEIGHT) {}
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override
+    {
+        if (x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT)
+            return;
+        uint8_t *p = bytes + (y * WIDTH + x) * 3;
+        panelColor565(color, p[0], p[1], p[2]);
+    }
+
+    uint8_t bytes[WIDTH * HEIGHT * 3];
+};
+
+static uint8_t coverRgb[WIDTH * HEIGHT * 3];
+static FrameCanvas canvas;
+static Marquee marquee;
+static uint32_t currentAlbumArtHash = 0;
+static uint32_t currentTrackHash = 0;
+
+static const char *coverUrl = "https://i.scdn.co/image/ab67616d00004851b1c4b76e23414c9f20242268";
+static const char *trackId = "4uLU6hMCjMI75M1A2tKUQC";
+static const char *trackText = "Never Gonna Give You Up - Rick Astley, a title long enough to scroll";
+
+// Poll compare, as in pollSpotify()
+static bool pollChanged(const char *url, const char *id)
+{
+    AllocGuard guard("poll compare");
+    bool coverChanged = hashUpdate(currentAlbumArtHash, url);
+    bool trackChanged = hashUpdate(currentTrackHash, id);
+    return coverChanged || trackChanged;
+}
+
+// Render, as in loop() with DITHER_TEMPORAL: the cover, the clock in its
+// colors and the marquee, drawn into the frame
+static void renderFrame(uint32_t frame, uint32_t nowMs)
+{
+    AllocGuard guard("render");
+
+    marquee.setText(trackText); // unchanged, so not rasterized again
+    ditherOrdered(coverRgb, canvas.bytes, WIDTH, HEIGHT, frame);
+
+    char clockText[6];
+    snprintf(clockText, sizeof(clockText), "%02u:%02u", (unsigned)(frame / 60 % 24), (unsigned)(frame % 60));
+    uint16_t bodyColor = getClockDigitColor(frame / 60 % 24, frame % 60);
+    for (int i = 0; clockText[i]; i++)
+        canvas.drawChar(3 + i * 12, 30, clockText[i], bodyColor, 0, 1);
+
+    marquee.draw(&canvas, MARQUEE_Y, bodyColor, 0, nowMs);
+}
+
+// The guard must see allocations from malloc and from new, or a clean run
+// proves nothing
+static void testGuardCounts()
+{
+    static void *volatile sink;
+    uint32_t before = allocGuardViolations();
+    {
+        AllocGuard guard("malloc");
+        sink = malloc(32);
+        free(sink);
+    }
+    CHECK(allocGuardViolations() == before + 1);
+    {
+        AllocGuard guard("new");
+        sink = new char[32];
+        delete[] static_cast<char *>(sink);
+    }
+    CHECK(allocGuardViolations() == before + 2);
+
+    // Outside a guard nothing is counted
+    sink = malloc(32);
+    free(sink);
+    CHECK(allocGuardViolations() == before + 2);
+}
+
+static void testSteadyState()
+{
+    panelColorBegin(PANEL_CALIBRATION_DEFAULT);
+    CHECK(marquee.begin());
+    for (int i = 0; i < WIDTH * HEIGHT * 3; i++)
+        coverRgb[i] = testRandom();
+
+    // First poll of a track: changes, and the marquee is rasterized once
+    CHECK(pollChanged(coverUrl, trackId));
+    marquee.setText(trackText);
+    CHECK(marquee.isScrolling());
+
+    uint32_t before = allocGuardViolations();
+    uint32_t changes = 0;
+    for (uint32_t frame = 0; frame < FRAMES; frame++)
+    {
+        if (frame % 30 == 0)
+            changes += pollChanged(coverUrl, trackId);
+        renderFrame(frame, frame * 1000 / MARQUEE_FPS);
+    }
+    CHECK(changes == 0);
+    CHECK(allocGuardViolations() == before);
+
+    // The marquee really was drawn
+    bool drawn = false;
+    for (int x = 0; x < WIDTH; x++)
+        drawn = drawn || canvas.bytes[(MARQUEE_Y * WIDTH + x) * 3] != 0;
+    CHECK(drawn);
+
+    // A new track is seen by the same compare
+    CHECK(pollChanged(coverUrl, "7GhIk7Il098yCjg4BQjzvb"));
+}
+
+int main()
+{
+    testGuardCounts();
+    testSteadyState();
+    return testResult();
+}
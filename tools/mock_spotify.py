@@ -0,0 +1,525 @@
+#!/usr/bin/env python3
+"""Local stand-in for the Spotify Web API, for load and failure testing.
+
+Build the firmware with SPOTIFY_MOCK_HOST set to this machine's address (see
+include/spotify_stats.h) and the clock polls this server instead of Spotify:
+currently-playing replies, token refreshes and cover images all come from
+here. A script of scenarios runs in order (normal playback, track changes,
+error codes, slow and truncated replies, bad covers), and a table per
+scenario shows what the clock did:
+
+  polls     requests and the status codes they got
+  gap       time between polls, which grows when the clock blocks
+  cover     delay from the announcing reply to the cover request, and the
+            transfer time
+  change    on-panel latency reported back by the clock (X-Clock-Change),
+            split into request, download and decode
+
+Usage:
+  tools/mock_spotify.py [--port 8080] [--seconds 30] [--scenario NAME ...]
+  tools/mock_spotify.py --list
+
+Standard library only.
+"""
+
+import argparse
+import json
+import random
+import struct
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+# ---------------------------------------------------------------------------
+# Covers: baseline JPEGs of 8x8 flat-colour blocks. Only DC coefficients are
+# coded, which keeps the encoder tiny and still gives the clock real colours
+# to pick from.
+
+DC_BITS = [0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0]  # ITU T.81 table K.3
+DC_VALUES = list(range(12))
+AC_BITS = [0, 2] + [0] * 14  # EOB plus one filler symbol
+AC_VALUES = [0x00, 0x01]
+
+
+def huffman_codes(bits, values):
+    codes, code, k = {}, 0, 0
+    for length, count in enumerate(bits, start=1):
+        for _ in range(count):
+            codes[values[k]] = (code, length)
+            code += 1
+            k += 1
+        code <<= 1
+    return codes
+
+
+DC_CODES = huffman_codes(DC_BITS, DC_VALUES)
+EOB = huffman_codes(AC_BITS, AC_VALUES)[0x00]
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.count = 0
+
+    def write(self, value, length):
+        for i in range(length - 1, -1, -1):
+            self.acc = (self.acc << 1) | ((value >> i) & 1)
+            self.count += 1
+            if self.count == 8:
+                self.out.append(self.acc)
+                if self.acc == 0xFF:
+                    self.out.append(0x00)  # byte stuffing
+                self.acc = 0
+                self.count = 0
+
+    def finish(self):
+        if self.count:
+            self.write(0x7F, 8 - self.count)  # pad with ones
+        return bytes(self.out)
+
+
+def segment(marker, payload):
+    return struct.pack(">BBH", 0xFF, marker, len(payload) + 2) + payload
+
+
+def encode_cover(blocks, size=64):
+    """blocks: (size/8)^2 RGB tuples in raster order -> JPEG bytes."""
+    n = size // 8
+    assert len(blocks) == n * n
+    bits = BitWriter()
+    predictors = [0, 0, 0]
+    for r, g, b in blocks:
+        ycc = (0.299 * r + 0.587 * g + 0.114 * b,
+               128 - 0.168736 * r - 0.331264 * g + 0.5 * b,
+               128 + 0.5 * r - 0.418688 * g - 0.081312 * b)
+        for c in range(3):
+            dc = max(-1024, min(1016, round(8 * (ycc[c] - 128))))  # quantizer 1
+            diff = dc - predictors[c]
+            predictors[c] = dc
+            category = abs(diff).bit_length()
+            code, length = DC_CODES[category]
+            bits.write(code, length)
+            if category:
+                bits.write(diff if diff > 0 else diff + (1 << category) - 1, category)
+            bits.write(*EOB)
+
+    dht = bytes([0x00]) + bytes(DC_BITS) + bytes(DC_VALUES) + bytes([0x10]) + bytes(AC_BITS) + bytes(AC_VALUES)
+    return (b"\xFF\xD8"
+            + segment(0xE0, b"JFIF\x00\x01\x01\x00\x00\x01\x00\x01\x00\x00")
+            + segment(0xDB, bytes([0x00]) + bytes([1] * 64))
+            + segment(0xC0, struct.pack(">BHHB", 8, size, size, 3) + bytes([1, 0x11, 0, 2, 0x11, 0, 3, 0x11, 0]))
+            + segment(0xC4, dht)
+            + segment(0xDA, bytes([3, 1, 0x00, 2, 0x00, 3, 0x00, 0, 63, 0]))
+            + bits.finish()
+            + b"\xFF\xD9")
+
+
+def cover_for_track(track):
+    rng = random.Random(track)
+    base = [rng.randrange(256) for _ in range(3)]
+    accent = [rng.randrange(256) for _ in range(3)]
+    blocks = []
+    for y in range(8):
+        for x in range(8):
+            t = (x + y) / 14
+            colour = [int(base[c] * (1 - t) + accent[c] * t) for c in range(3)]
+            blocks.append(tuple(colour))
+    return encode_cover(blocks)
+
+
+def with_dimensions(jpeg, width, height):
+    """Same file with the frame header claiming another size."""
+    at = jpeg.index(b"\xFF\xC0") + 5
+    return jpeg[:at] + struct.pack(">HH", height, width) + jpeg[at + 4:]
+
+
+# ---------------------------------------------------------------------------
+# Scenarios. Each one decides how the next currently-playing request and the
+# next cover request are answered.
+
+class Scenario:
+    name = ""
+    description = ""
+    change_every = 0  # polls between track changes, 0 = same track throughout
+
+    def poll(self, handler, server):
+        server.send_json(handler, 200, server.playing_reply(handler))
+
+    def cover(self, handler, server, jpeg):
+        server.send_bytes(handler, 200, jpeg, "image/jpeg")
+
+
+class Steady(Scenario):
+    name = "steady"
+    description = "playing, same track: baseline poll cost"
+
+
+class TrackChanges(Scenario):
+    name = "track_changes"
+    description = "a new track and cover every third poll"
+    change_every = 3
+
+
+class Paused(Scenario):
+    name = "paused"
+    description = "200 with is_playing false"
+
+    def poll(self, handler, server):
+        reply = server.playing_reply(handler)
+        reply["is_playing"] = False
+        server.send_json(handler, 200, reply)
+
+
+class NoContent(Scenario):
+    name = "no_content"
+    description = "204, nothing playing"
+
+    def poll(self, handler, server):
+        server.send_bytes(handler, 204, b"", None)
+
+
+class TokenExpired(Scenario):
+    name = "token_expired"
+    description = "401 until the clock refreshes its token"
+
+    def poll(self, handler, server):
+        if server.token_valid:
+            Scenario.poll(self, handler, server)
+        else:
+            server.send_json(handler, 401, {"error": {"status": 401, "message": "The access token expired"}})
+
+
+class RateLimited(Scenario):
+    name = "rate_limited"
+    description = "429 with Retry-After"
+
+    def poll(self, handler, server):
+        server.send_json(handler, 429, {"error": {"status": 429, "message": "API rate limit exceeded"}},
+                         {"Retry-After": "5"})
+
+
+class SlowHeaders(Scenario):
+    name = "slow_headers"
+    description = "no response for 5 s, past the clock's read timeout"
+
+    def poll(self, handler, server):
+        time.sleep(5)
+        Scenario.poll(self, handler, server)
+
+
+class SlowBody(Scenario):
+    name = "slow_body"
+    description = "headers at once, body trickled over 4 s"
+
+    def poll(self, handler, server):
+        body = json.dumps(server.playing_reply(handler)).encode()
+        server.send_head(handler, 200, "application/json", len(body))
+        for i in range(0, len(body), max(1, len(body) // 8)):
+            handler.wfile.write(body[i:i + max(1, len(body) // 8)])
+            handler.wfile.flush()
+            time.sleep(0.5)
+
+
+class TruncatedBody(Scenario):
+    name = "truncated_body"
+    description = "Content-Length promises more than is sent"
+
+    def poll(self, handler, server):
+        body = json.dumps(server.playing_reply(handler)).encode()
+        server.send_head(handler, 200, "application/json", len(body))
+        handler.wfile.write(body[:len(body) // 2])
+        handler.close_connection = True
+
+
+class MalformedJson(Scenario):
+    name = "malformed_json"
+    description = "200 with a body that is not JSON"
+
+    def poll(self, handler, server):
+        server.send_bytes(handler, 200, b'{"is_playing": tru', "application/json")
+
+
+class SlowCover(TrackChanges):
+    name = "slow_cover"
+    description = "track changes, covers trickled over 6 s"
+
+    def cover(self, handler, server, jpeg):
+        server.send_head(handler, 200, "image/jpeg", len(jpeg))
+        step = max(1, len(jpeg) // 12)
+        for i in range(0, len(jpeg), step):
+            handler.wfile.write(jpeg[i:i + step])
+            handler.wfile.flush()
+            time.sleep(0.5)
+
+
+class TruncatedCover(TrackChanges):
+    name = "truncated_cover"
+    description = "track changes, covers cut in half"
+
+    def cover(self, handler, server, jpeg):
+        server.send_head(handler, 200, "image/jpeg", len(jpeg))
+        handler.wfile.write(jpeg[:len(jpeg) // 2])
+        handler.close_connection = True
+
+
+class OversizedCover(TrackChanges):
+    name = "oversized_cover"
+    description = "track changes, 100 KB covers (over NET_MAX_COVER_BYTES)"
+
+    def cover(self, handler, server, jpeg):
+        server.send_bytes(handler, 200, jpeg[:-2] + bytes(100 * 1024) + b"\xFF\xD9", "image/jpeg")
+
+
+class CorruptCover(TrackChanges):
+    name = "corrupt_cover"
+    description = "track changes, covers with random bytes in headers and data"
+
+    def cover(self, handler, server, jpeg):
+        data = bytearray(jpeg)
+        for _ in range(8):
+            data[random.randrange(2, len(data))] = random.randrange(256)
+        server.send_bytes(handler, 200, bytes(data), "image/jpeg")
+
+
+class HugeDimensions(TrackChanges):
+    name = "huge_dimensions"
+    description = "track changes, covers claiming 4000x4000 pixels"
+
+    def cover(self, handler, server, jpeg):
+        server.send_bytes(handler, 200, with_dimensions(jpeg, 4000, 4000), "image/jpeg")
+
+
+SCENARIOS = [Steady(), TrackChanges(), Paused(), NoContent(), TokenExpired(), RateLimited(),
+             SlowHeaders(), SlowBody(), TruncatedBody(), MalformedJson(), SlowCover(),
+             TruncatedCover(), OversizedCover(), CorruptCover(), HugeDimensions()]
+
+
+# ---------------------------------------------------------------------------
+# Measurements
+
+class Stats:
+    def __init__(self):
+        self.polls = 0
+        self.statuses = {}
+        self.gaps = []
+        self.cover_delays = []
+        self.cover_transfers = []
+        self.changes = []  # (latency, request, download, decode) from the clock
+
+    @staticmethod
+    def summary(values):
+        if not values:
+            return "-"
+        return "%d/%d" % (sum(values) / len(values), max(values))
+
+    def row(self, name):
+        statuses = " ".join("%s:%d" % item for item in sorted(self.statuses.items()))
+        columns = list(zip(*self.changes)) if self.changes else [[], [], [], []]
+        return "%-16s %5d  %-22s %-12s %-12s %-12s %-12s %-9s %-9s %-9s" % (
+            name, self.polls, statuses or "-", self.summary(self.gaps), self.summary(self.cover_delays),
+            self.summary(self.cover_transfers), self.summary(columns[0]), self.summary(columns[1]),
+            self.summary(columns[2]), self.summary(columns[3]))
+
+
+HEADER = "%-16s %5s  %-22s %-12s %-12s %-12s %-12s %-9s %-9s %-9s" % (
+    "scenario", "polls", "status codes", "gap ms", "cover wait", "cover xfer", "change ms",
+    "request", "download", "decode")
+
+
+class MockSpotify(ThreadingHTTPServer):
+    daemon_threads = True
+
+    def __init__(self, address, scenarios, seconds):
+        super().__init__(address, Handler)
+        self.scenarios = scenarios
+        self.seconds = seconds
+        self.lock = threading.Lock()
+        self.index = 0
+        self.started = time.monotonic()
+        self.stats = {s.name: Stats() for s in scenarios}
+        self.track = 1
+        self.polls_on_track = 0
+        self.token_valid = True
+        self.last_poll = None
+        self.announced = {}  # track -> time the reply naming its cover went out
+        self.last_change_count = None
+
+    @property
+    def scenario(self):
+        return self.scenarios[self.index]
+
+    def advance(self):
+        """Moves to the next scenario when the current one has run its time."""
+        with self.lock:
+            if time.monotonic() - self.started < self.seconds:
+                return
+            print(self.stats[self.scenario.name].row(self.scenario.name), flush=True)
+            self.index = (self.index + 1) % len(self.scenarios)
+            self.started = time.monotonic()
+            self.last_poll = None
+            self.token_valid = not isinstance(self.scenario, TokenExpired)
+            print("-> %s: %s" % (self.scenario.name, self.scenario.description), flush=True)
+
+    def playing_reply(self, handler):
+        with self.lock:
+            scenario = self.scenario
+            if scenario.change_every:
+                self.polls_on_track += 1
+                if self.polls_on_track >= scenario.change_every:
+                    self.polls_on_track = 0
+                    self.track += 1
+            track = self.track
+            self.announced.setdefault(track, time.monotonic())
+        host = handler.headers.get("Host", "%s:%d" % self.server_address)
+        return {
+            "is_playing": True,
+            "progress_ms": 1000,
+            "item": {
+                "id": "mocktrack%06d" % track,
+                "name": "Mock Track %d" % track,
+                "artists": [{"name": "Mock Artist"}, {"name": scenario.name}],
+                "album": {"images": [{}, {}, {"url": "http://%s/cover/%d.jpg" % (host, track), "width": 64, "height": 64}]},
+            },
+        }
+
+    def send_head(self, handler, status, content_type, length, headers=None):
+        handler.send_response(status)
+        if content_type:
+            handler.send_header("Content-Type", content_type)
+        handler.send_header("Content-Length", str(length))
+        for key, value in (headers or {}).items():
+            handler.send_header(key, value)
+        handler.end_headers()
+
+    def send_bytes(self, handler, status, body, content_type, headers=None):
+        self.send_head(handler, status, content_type, len(body), headers)
+        handler.wfile.write(body)
+
+    def send_json(self, handler, status, value, headers=None):
+        self.send_bytes(handler, status, json.dumps(value).encode(), "application/json", headers)
+
+    def record_poll(self, handler):
+        now = time.monotonic()
+        with self.lock:
+            stats = self.stats[self.scenario.name]
+            stats.polls += 1
+            if self.last_poll is not None:
+                stats.gaps.append((now - self.last_poll) * 1000)
+            self.last_poll = now
+
+            # count,latency,request,download,decode of the clock's last change
+            report = handler.headers.get("X-Clock-Change")
+            if report:
+                try:
+                    count, *stages = [int(v) for v in report.split(",")]
+                except ValueError:
+                    return stats
+                if self.last_change_count is not None and count != self.last_change_count:
+                    stats.changes.append(stages)
+                self.last_change_count = count
+            return stats
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.0"
+    server_version = "MockSpotify/1.0"
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def do_GET(self):
+        server = self.server
+        server.advance()
+        scenario = server.scenario
+
+        if self.path.startswith("/v1/me/player/currently-playing"):
+            stats = server.record_poll(self)
+            status = []
+            original = self.send_response
+
+            def send_response(code, message=None):
+                status.append(code)
+                original(code, message)
+
+            self.send_response = send_response
+            try:
+                scenario.poll(self, server)
+            except (BrokenPipeError, ConnectionResetError):
+                pass
+            code = status[0] if status else "drop"
+            with server.lock:
+                stats.statuses[code] = stats.statuses.get(code, 0) + 1
+
+        elif self.path.startswith("/cover/"):
+            try:
+                track = int(self.path[len("/cover/"):].split(".")[0])
+            except ValueError:
+                self.send_error(404)
+                return
+            start = time.monotonic()
+            with server.lock:
+                announced = server.announced.get(track)
+                stats = server.stats[scenario.name]
+            try:
+                scenario.cover(self, server, cover_for_track(track))
+            except (BrokenPipeError, ConnectionResetError):
+                pass
+            with server.lock:
+                if announced is not None:
+                    stats.cover_delays.append((start - announced) * 1000)
+                stats.cover_transfers.append((time.monotonic() - start) * 1000)
+        else:
+            self.send_error(404)
+
+    def do_POST(self):
+        # Token refresh: always succeeds and ends a token_expired scenario
+        length = int(self.headers.get("Content-Length", 0))
+        self.rfile.read(length)
+        if self.path.startswith("/api/token"):
+            self.server.token_valid = True
+            self.server.send_json(self, 200, {"access_token": "mock", "token_type": "Bearer", "expires_in": 3600})
+        else:
+            self.send_error(404)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--seconds", type=float, default=30, help="time per scenario")
+    parser.add_argument("--scenario", action="append", help="run only these scenarios, in this order")
+    parser.add_argument("--list", action="store_true", help="list the scenarios and exit")
+    parser.add_argument("--write-cover", metavar="FILE", help="write a sample cover JPEG and exit")
+    args = parser.parse_args()
+
+    if args.list:
+        for s in SCENARIOS:
+            print("%-16s %s" % (s.name, s.description))
+        return
+    if args.write_cover:
+        with open(args.write_cover, "wb") as f:
+            f.write(cover_for_track(1))
+        return
+
+    by_name = {s.name: s for s in SCENARIOS}
+    try:
+        scenarios = [by_name[name] for name in args.scenario] if args.scenario else SCENARIOS
+    except KeyError as e:
+        sys.exit("unknown scenario %s, see --list" % e)
+
+    server = MockSpotify(("", args.port), scenarios, args.seconds)
+    server.token_valid = not isinstance(scenarios[0], TokenExpired)
+    print("Mock Spotify on port %d, %d s per scenario" % (args.port, args.seconds))
+    print("Times are avg/max in ms\n" + HEADER)
+    print("-> %s: %s" % (server.scenario.name, server.scenario.description), flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        print("\n" + HEADER)
+        for s in scenarios:
+            print(server.stats[s.name].row(s.name))
+
+
+if __name__ == "__main__":
+    main()